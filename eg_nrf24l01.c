@@ -14,12 +14,12 @@
 #define EG_NRF24L01_SETUP_AW_4BYTES 2u
 #define EG_NRF24L01_SETUP_AW_5BYTES 3u
 
-#define POWER_ON_TIME_MS 100u /**< Time needed to power on then module */
-
 #define NRF_CMD_READ_REG 0x00u
 #define NRF_CMD_WRITE_REG 0x20u
+#define NRF_CMD_R_RX_PL_WID 0x60u
 #define NRF_CMD_R_RX_PAYLOAD 0x61u
 #define NRF_CMD_W_TX_PAYLOAD 0xA0u
+#define NRF_CMD_W_ACK_PAYLOAD 0xA8u
 #define NRF_CMD_W_TX_PAYLOAD_NO_ACK 0xB0u
 #define NRF_CMD_FLUSH_TX 0xE1
 #define NRF_CMD_FLUSH_RX 0xE2
@@ -49,6 +49,56 @@
 #define NRF_REG_RX_PW_P4 0x15u
 #define NRF_REG_RX_PW_P5 0x16u
 #define NRF_REG_FIFO_STATUS 0x17u
+#define NRF_REG_DYNPD 0x1Cu
+#define NRF_REG_FEATURE 0x1Du
+
+#define NRF_MAX_CHANNEL (EG_NRF24L01_CHANNEL_CNT - 1u)
+
+#if EG_NRF24L01_STATS
+#define STATS_ADD(state, counter, value) ((state)->stats.counter += (value))
+#else
+#define STATS_ADD(state, counter, value) ((void)0)
+#endif
+
+/** flags bits - set from API, IRQ and SPI completion contexts, so modified atomically only */
+#define FLAG_POWER_ON_REQUEST 0x01u /**< Power on requested */
+#define FLAG_WAKE_UP_REQUEST 0x02u  /**< Wake up requested */
+#define FLAG_SLEEP_REQUEST 0x04u    /**< Sleep requested */
+#define FLAG_IRQ_PENDING 0x08u      /**< IRQ signalled by eg_nrf24l01_irq_handler */
+#define FLAG_SPI_DATA_READY 0x10u   /**< No SPI transfer in progress */
+#define FLAG_TX_PAUSED 0x20u        /**< Payloads are kept in TX queue */
+#define FLAG_SM_ACTIVE 0x40u        /**< State machine is being executed */
+#define FLAG_IRQ_STAMPED 0x80u      /**< IRQ timestamp not consumed by payload delivery - stats only */
+
+/** Set flag bits, evaluates to the previous flags value */
+#define FLAG_SET(state, flag) EG_NRF24L01_ATOMIC_OR(&(state)->flags, (uint8_t)(flag))
+/** Clear flag bits */
+#define FLAG_CLEAR(state, flag) EG_NRF24L01_ATOMIC_AND(&(state)->flags, (uint8_t)~(flag))
+/** Flag bit state - 0 or 1 */
+#define FLAG_GET(state, flag) ((uint8_t)(0u != ((state)->flags & (flag))))
+
+#define TX_QUEUE_MASK (EG_NRF24L01_TX_QUEUE_SIZE - 1u)
+
+_Static_assert((EG_NRF24L01_TX_QUEUE_SIZE & TX_QUEUE_MASK) == 0u, "EG_NRF24L01_TX_QUEUE_SIZE must be a power of two");
+_Static_assert(EG_NRF24L01_TX_QUEUE_SIZE <= 128u, "EG_NRF24L01_TX_QUEUE_SIZE too big");
+
+/** Shared bus owner value while the next instance is being picked - never dereferenced */
+#define BUS_PICKING(bus) ((eg_nrf24l01_state_s *)(void *)(bus))
+
+_Static_assert(EG_NRF24L01_BUS_MAX_INSTANCES <= 32u, "EG_NRF24L01_BUS_MAX_INSTANCES too big");
+
+#if EG_NRF24L01_RX_RING_SIZE > 0u
+#define RX_RING_MASK (EG_NRF24L01_RX_RING_SIZE - 1u)
+
+_Static_assert((EG_NRF24L01_RX_RING_SIZE & RX_RING_MASK) == 0u, "EG_NRF24L01_RX_RING_SIZE must be a power of two");
+_Static_assert(EG_NRF24L01_RX_RING_SIZE <= 128u, "EG_NRF24L01_RX_RING_SIZE too big");
+#endif
+
+#if EG_NRF24L01_TRACE_DEPTH > 0u
+#define TRACE_MASK (EG_NRF24L01_TRACE_DEPTH - 1u)
+_Static_assert((EG_NRF24L01_TRACE_DEPTH & TRACE_MASK) == 0u, "EG_NRF24L01_TRACE_DEPTH must be a power of two");
+_Static_assert(EG_NRF24L01_TRACE_DEPTH >= 2u, "EG_NRF24L01_TRACE_DEPTH too small");
+#endif
 
 static void sm_state_power_off_handler(eg_nrf24l01_state_s *state);
 static void sm_state_module_startup_handler(eg_nrf24l01_state_s *state);
@@ -63,7 +113,17 @@ static void sm_state_receiving_handler(eg_nrf24l01_state_s *state);
 static void sm_state_receiving_clear_handler(eg_nrf24l01_state_s *state);
 static void sm_state_transmit_handler(eg_nrf24l01_state_s *state);
 static void sm_state_transmitting_handler(eg_nrf24l01_state_s *state);
+static void sm_state_transmit_clear_handler(eg_nrf24l01_state_s *state);
+static void sm_state_transmit_clearing_handler(eg_nrf24l01_state_s *state);
+static void sm_state_observe_tx_reading_handler(eg_nrf24l01_state_s *state);
+static void sm_state_reg_flush_handler(eg_nrf24l01_state_s *state);
 static void sm_state_powering_off_handler(eg_nrf24l01_state_s *state);
+static void sm_state_powering_up_handler(eg_nrf24l01_state_s *state);
+#if EG_NRF24L01_SCAN
+static void sm_state_scan_channel_handler(eg_nrf24l01_state_s *state);
+static void sm_state_scan_dwell_handler(eg_nrf24l01_state_s *state);
+static void sm_state_scan_reading_handler(eg_nrf24l01_state_s *state);
+#endif
 
 static void spi_write_register(eg_nrf24l01_state_s *state,
                                uint8_t reg,
@@ -72,26 +132,148 @@ static void spi_write_register(eg_nrf24l01_state_s *state,
 static void spi_read_register(eg_nrf24l01_state_s *state,
                               uint8_t reg,
                               uint8_t read_len);
+static void spi_transfer(eg_nrf24l01_state_s *state,
+                         uint8_t *tx_buf,
+                         uint8_t tx_len,
+                         uint8_t *rx_buf,
+                         uint8_t rx_len);
+static void spi_start(eg_nrf24l01_state_s *state);
+static void bus_release(eg_nrf24l01_state_s *state);
+static void bus_kick(eg_nrf24l01_bus_s *bus);
+static uint8_t bus_waiting(eg_nrf24l01_bus_s *bus);
+static uint32_t bus_service_mask(eg_nrf24l01_bus_s *bus);
+static eg_nrf24l01_state_s *bus_pick(eg_nrf24l01_bus_s *bus, uint32_t service);
+#if EG_NRF24L01_TRACE_DEPTH > 0u
+static void trace_start(eg_nrf24l01_state_s *state);
+static void trace_complete(eg_nrf24l01_state_s *state);
+#endif
+static void set_ce(eg_nrf24l01_state_s *state, uint8_t pin_state);
+static uint8_t time_elapsed(eg_nrf24l01_state_s *state);
+static uint8_t tx_queue_count(eg_nrf24l01_state_s *state);
+static eg_nrf_error_e tx_queue_put(eg_nrf24l01_state_s *state, uint8_t cmd, const uint8_t *data, uint8_t data_len);
+static uint8_t tx_prim_rx_needed(eg_nrf24l01_state_s *state);
+static uint8_t rx_ring_free(eg_nrf24l01_state_s *state);
+static eg_nrf24l01_sm_state_e tx_clear_next_state(eg_nrf24l01_state_s *state);
+static void tx_report(eg_nrf24l01_state_s *state, uint8_t sent, uint8_t failed);
+static void rx_dr_observe(eg_nrf24l01_state_s *state, uint8_t status);
+static void rx_payload_read(eg_nrf24l01_state_s *state);
+static void rx_burst_next(eg_nrf24l01_state_s *state);
+static eg_nrf24l01_sm_state_e idle_next_state(eg_nrf24l01_state_s *state);
+static void sm_step(eg_nrf24l01_state_s *state);
+static void sm_run(eg_nrf24l01_state_s *state);
+static uint8_t *reg_cache(eg_nrf24l01_state_s *state, uint8_t idx);
+static void reg_mark_dirty(eg_nrf24l01_state_s *state, uint32_t dirty);
+static uint8_t reg_flush_next(eg_nrf24l01_state_s *state);
+static eg_nrf_error_e rx_payload_width_apply(eg_nrf24l01_state_s *state, uint8_t pipe, uint8_t payload_width);
+#if EG_NRF24L01_STATS
+static void stats_hist_add(uint32_t *hist, uint32_t ticks);
+#endif
+static void event_signal(eg_nrf24l01_state_s *state, eg_nrf_event_e event);
+static uint8_t sm_deadline_check(eg_nrf24l01_state_s *state);
+#if EG_NRF24L01_SPI_TIMEOUT_US > 0u || EG_NRF24L01_TX_TIMEOUT_US > 0u
+static void sm_recover(eg_nrf24l01_state_s *state);
+#endif
 
 typedef void (*state_handler)(eg_nrf24l01_state_s *state);
 
-const state_handler state_handlers_lut[NRF_SM_MAX_STATE] = {
-    sm_state_power_off_handler,
-    sm_state_module_startup_handler,
-    sm_state_configure_handler,
-    sm_state_sleep_handler,
-    sm_state_idle_handler,
-    sm_state_status_read_handler,
-    sm_state_status_reading_handler,
-    sm_state_receive_handler,
-    sm_state_receiving_length_handler,
-    sm_state_receiving_handler,
-    sm_state_receiving_clear_handler,
-    sm_state_transmit_handler,
-    sm_state_transmitting_handler,
-    sm_state_powering_off_handler};
-
-eg_nrf_error_e eg_nrf24l01_init(eg_nrf24l01_state_s *state, eg_nrf24l01_init_data_s *init_data)
+/** Single register write of the configuration script */
+typedef struct
+{
+    uint8_t reg;     /**< Register address or command */
+    uint16_t offset; /**< Offset of the written value in driver state object */
+    uint8_t len;     /**< Number of bytes to write */
+} configure_step_s;
+
+/** Configuration script entry writing register from its cached value */
+#define CONFIGURE_REG(reg, field) \
+    {(reg), offsetof(eg_nrf24l01_state_s, config_registers.field), sizeof(((eg_nrf24l01_state_s *)NULL)->config_registers.field)}
+/** Configuration script entry sending single byte command */
+#define CONFIGURE_CMD(cmd) {(cmd), 0u, 0u}
+
+/** Configuration script entries - entry index is its bit in reg_dirty */
+typedef enum
+{
+    REG_IDX_CONFIG = 0,
+    REG_IDX_EN_AA,
+    REG_IDX_EN_RXADDR,
+    REG_IDX_SETUP_AW,
+    REG_IDX_SETUP_RETR,
+    REG_IDX_RF_CH,
+    REG_IDX_RF_SETUP,
+    REG_IDX_RX_ADDR_P0,
+    REG_IDX_RX_PW_P0 = REG_IDX_RX_ADDR_P0 + EG_NRF24L01_MAX_ADDRESS_NO,
+    REG_IDX_FEATURE = REG_IDX_RX_PW_P0 + EG_NRF24L01_MAX_ADDRESS_NO,
+    REG_IDX_DYNPD,
+    REG_IDX_TX_ADDR,
+    REG_IDX_FLUSH_TX,
+    REG_IDX_FLUSH_RX,
+    REG_IDX_MAX,
+} configure_idx_e;
+
+/** Module configuration script - dirty entries are written one per state machine step, lowest index first */
+static const configure_step_s configure_script[REG_IDX_MAX] = {
+    [REG_IDX_CONFIG] = CONFIGURE_REG(NRF_REG_CONFIG, config),
+    [REG_IDX_EN_AA] = CONFIGURE_REG(NRF_REG_EN_AA, en_aa),
+    [REG_IDX_EN_RXADDR] = CONFIGURE_REG(NRF_REG_EN_RXADDR, en_rxaddr),
+    [REG_IDX_SETUP_AW] = CONFIGURE_REG(NRF_REG_SETUP_AW, setup_aw),
+    [REG_IDX_SETUP_RETR] = CONFIGURE_REG(NRF_REG_SETUP_RETR, setup_retr),
+    [REG_IDX_RF_CH] = CONFIGURE_REG(NRF_REG_RF_CH, rf_ch),
+    [REG_IDX_RF_SETUP] = CONFIGURE_REG(NRF_REG_RF_SETUP, rf_setup),
+    [REG_IDX_RX_ADDR_P0] = CONFIGURE_REG(NRF_REG_RX_ADDR_P0, rx_addr_p0),
+    [REG_IDX_RX_ADDR_P0 + 1u] = CONFIGURE_REG(NRF_REG_RX_ADDR_P1, rx_addr_p1),
+    [REG_IDX_RX_ADDR_P0 + 2u] = CONFIGURE_REG(NRF_REG_RX_ADDR_P2, rx_addr_p2),
+    [REG_IDX_RX_ADDR_P0 + 3u] = CONFIGURE_REG(NRF_REG_RX_ADDR_P3, rx_addr_p3),
+    [REG_IDX_RX_ADDR_P0 + 4u] = CONFIGURE_REG(NRF_REG_RX_ADDR_P4, rx_addr_p4),
+    [REG_IDX_RX_ADDR_P0 + 5u] = CONFIGURE_REG(NRF_REG_RX_ADDR_P5, rx_addr_p5),
+    [REG_IDX_RX_PW_P0] = CONFIGURE_REG(NRF_REG_RX_PW_P0, rx_pw_p0),
+    [REG_IDX_RX_PW_P0 + 1u] = CONFIGURE_REG(NRF_REG_RX_PW_P1, rx_pw_p1),
+    [REG_IDX_RX_PW_P0 + 2u] = CONFIGURE_REG(NRF_REG_RX_PW_P2, rx_pw_p2),
+    [REG_IDX_RX_PW_P0 + 3u] = CONFIGURE_REG(NRF_REG_RX_PW_P3, rx_pw_p3),
+    [REG_IDX_RX_PW_P0 + 4u] = CONFIGURE_REG(NRF_REG_RX_PW_P4, rx_pw_p4),
+    [REG_IDX_RX_PW_P0 + 5u] = CONFIGURE_REG(NRF_REG_RX_PW_P5, rx_pw_p5),
+    [REG_IDX_FEATURE] = CONFIGURE_REG(NRF_REG_FEATURE, feature),
+    [REG_IDX_DYNPD] = CONFIGURE_REG(NRF_REG_DYNPD, dynpd),
+    [REG_IDX_TX_ADDR] = CONFIGURE_REG(NRF_REG_TX_ADDR, tx_addr),
+    [REG_IDX_FLUSH_TX] = CONFIGURE_CMD(NRF_CMD_FLUSH_TX),
+    [REG_IDX_FLUSH_RX] = CONFIGURE_CMD(NRF_CMD_FLUSH_RX),
+};
+
+/** reg_dirty bit of configuration script entry */
+#define REG_DIRTY(idx) ((uint32_t)1u << (idx))
+/** Every configuration script entry - full module configuration */
+#define REG_DIRTY_ALL (REG_DIRTY(REG_IDX_MAX) - 1u)
+_Static_assert(REG_IDX_MAX < 32u, "Configuration script does not fit in reg_dirty");
+
+/* Entries are bound to their states - enum order changes cannot misroute a state */
+static const state_handler state_handlers_lut[] = {
+    [NRF_SM_POWER_OFF]          = sm_state_power_off_handler,
+    [NRF_SM_MODULE_STARTUP]     = sm_state_module_startup_handler,
+    [NRF_SM_CONFIGURE]          = sm_state_configure_handler,
+    [NRF_SM_SLEEP]              = sm_state_sleep_handler,
+    [NRF_SM_IDLE]               = sm_state_idle_handler,
+    [NRF_SM_STATUS_READ]        = sm_state_status_read_handler,
+    [NRF_SM_STATUS_READING]     = sm_state_status_reading_handler,
+    [NRF_SM_RECEIVE]            = sm_state_receive_handler,
+    [NRF_SM_RECEIVING_LENGTH]   = sm_state_receiving_length_handler,
+    [NRF_SM_RECEIVING]          = sm_state_receiving_handler,
+    [NRF_SM_RECEIVING_CLEAR]    = sm_state_receiving_clear_handler,
+    [NRF_SM_TRANSMIT]           = sm_state_transmit_handler,
+    [NRF_SM_TRANSMITTING]       = sm_state_transmitting_handler,
+    [NRF_SM_TRANSMIT_CLEAR]     = sm_state_transmit_clear_handler,
+    [NRF_SM_TRANSMIT_CLEARING]  = sm_state_transmit_clearing_handler,
+    [NRF_SM_OBSERVE_TX_READING] = sm_state_observe_tx_reading_handler,
+    [NRF_SM_REG_FLUSH]          = sm_state_reg_flush_handler,
+    [NRF_SM_POWERING_OFF]       = sm_state_powering_off_handler,
+    [NRF_SM_POWERING_UP]        = sm_state_powering_up_handler,
+#if EG_NRF24L01_SCAN
+    [NRF_SM_SCAN_CHANNEL]       = sm_state_scan_channel_handler,
+    [NRF_SM_SCAN_DWELL]         = sm_state_scan_dwell_handler,
+    [NRF_SM_SCAN_READING]       = sm_state_scan_reading_handler,
+#endif
+};
+_Static_assert(sizeof(state_handlers_lut) / sizeof(state_handlers_lut[0]) == NRF_SM_MAX_STATE, "State without handler");
+
+eg_nrf_error_e eg_nrf24l01_init(eg_nrf24l01_state_s *state, const eg_nrf24l01_init_data_s *init_data)
 {
     if (NULL == state || NULL == init_data)
     {
@@ -106,19 +288,11 @@ eg_nrf_error_e eg_nrf24l01_init(eg_nrf24l01_state_s *state, eg_nrf24l01_init_dat
     }
     state->config_registers.setup_aw.aw = (uint8_t)init_data->address_width;
 
-    const struct
-    {
-        uint8_t *dest_address;
-        eg_nrf24l01_rx_pw_px_reg_s *rx_pw_px;
-    } addr_lut[EG_NRF24L01_MAX_ADDRESS_NO] =
-        {
-            {.dest_address = state->config_registers.rx_addr_p0, .rx_pw_px = &state->config_registers.rx_pw_p0},
-            {.dest_address = state->config_registers.rx_addr_p1, .rx_pw_px = &state->config_registers.rx_pw_p1},
-            {.dest_address = &state->config_registers.rx_addr_p2, .rx_pw_px = &state->config_registers.rx_pw_p2},
-            {.dest_address = &state->config_registers.rx_addr_p3, .rx_pw_px = &state->config_registers.rx_pw_p3},
-            {.dest_address = &state->config_registers.rx_addr_p4, .rx_pw_px = &state->config_registers.rx_pw_p4},
-            {.dest_address = &state->config_registers.rx_addr_p5, .rx_pw_px = &state->config_registers.rx_pw_p5},
-        };
+    /* Module reset values - changed at runtime with the setters */
+    state->config_registers.setup_retr.arc = 3u;
+    state->config_registers.rf_ch.rf_ch = 2u;
+    state->config_registers.rf_setup.rf_pwr = RF_POWER_0DBM;
+    state->config_registers.rf_setup.rf_dr_high = 1u;
 
     for (uint8_t i = 0; i < EG_NRF24L01_MAX_ADDRESS_NO; i++)
     {
@@ -127,14 +301,15 @@ eg_nrf_error_e eg_nrf24l01_init(eg_nrf24l01_state_s *state, eg_nrf24l01_init_dat
             switch (i)
             {
             case 0u ... 1u:
-                memcpy(addr_lut[i].dest_address, init_data->rx_pipe[i].address, EG_NRF24L01_ADDRESS_MAX_WIDTH);
+                memcpy(reg_cache(state, REG_IDX_RX_ADDR_P0 + i), init_data->rx_pipe[i].address, EG_NRF24L01_ADDRESS_MAX_WIDTH);
                 break;
             case 2u ... 5u:
-                if (0 != memcmp(init_data->rx_pipe[1u].address, init_data->rx_pipe[i].address, EG_NRF24L01_ADDRESS_MAX_WIDTH - 1u))
+                /* Address is written LSByte first - P2-P5 registers hold the LSByte only */
+                if (0 != memcmp(&init_data->rx_pipe[1u].address[1u], &init_data->rx_pipe[i].address[1u], EG_NRF24L01_ADDRESS_MAX_WIDTH - 1u))
                 {
                     return NRF_INVALID_P2_P5_ADDRESS;
                 }
-                *addr_lut[i].dest_address = init_data->rx_pipe[i].address[EG_NRF24L01_ADDRESS_MAX_WIDTH - 1u];
+                *reg_cache(state, REG_IDX_RX_ADDR_P0 + i) = init_data->rx_pipe[i].address[0u];
                 break;
             default:
                 /* Unexpected */
@@ -147,17 +322,45 @@ eg_nrf_error_e eg_nrf24l01_init(eg_nrf24l01_state_s *state, eg_nrf24l01_init_dat
                 state->config_registers.en_aa.val |= 1u << i;
             }
 
+#if EG_NRF24L01_RX_RING_SIZE == 0u
             state->rx_pipe[i].rx_callback = init_data->rx_pipe[i].rx_callback;
+#endif
 
-            addr_lut[i].rx_pw_px->rx_pw_px = 10;
+            eg_nrf_error_e err = rx_payload_width_apply(state, i, init_data->rx_pipe[i].payload_width);
+            if (NRF_OK != err)
+            {
+                return err;
+            }
         }
     }
 
+    memcpy(state->config_registers.tx_addr, init_data->tx_address, EG_NRF24L01_ADDRESS_MAX_WIDTH);
+
+    if (1u == init_data->ack_payload)
+    {
+        /* ACK payload requires dynamic payload length */
+        state->config_registers.feature.en_ack_pay = 1u;
+        state->config_registers.feature.en_dpl = 1u;
+    }
+    if (1u == init_data->no_ack)
+    {
+        state->config_registers.feature.en_dyn_ack = 1u;
+    }
+
     state->config_registers.config.en_crc = 1u;
 
+    state->irq_driven = (1u == init_data->use_irq_handler);
+    state->spi_chaining = (1u == init_data->spi_chaining);
     state->set_ce_callback = init_data->set_ce_callback;
     state->set_csn_callback = init_data->set_csn_callback;
     state->get_irq_callback = init_data->ger_irq_callback;
+    state->event_callback = init_data->event_callback;
+    state->spi_abort_callback = init_data->spi_abort_callback;
+    /* No transfer in progress */
+    FLAG_SET(state, FLAG_SPI_DATA_READY);
+#if EG_NRF24L01_STATS
+    state->stats_state_enter = eg_nrf24l01_user_stats_ticks_get();
+#endif
 
     return NRF_OK;
 }
@@ -168,12 +371,14 @@ void eg_nrf24l01_process(eg_nrf24l01_state_s *state)
     {
         return;
     }
-    if (state->sm_state >= NRF_SM_MAX_STATE)
+    if (1u == state->spi_chaining)
     {
-        return;
+        sm_run(state);
+    }
+    else
+    {
+        sm_step(state);
     }
-    /* Execute state handler */
-    state_handlers_lut[state->sm_state](state);
 }
 
 eg_nrf_error_e eg_nrf24l01_power_on(eg_nrf24l01_state_s *state)
@@ -183,7 +388,7 @@ eg_nrf_error_e eg_nrf24l01_power_on(eg_nrf24l01_state_s *state)
         return NRF_INVALID_ARGUMENT;
     }
 
-    state->power_on_request = 1u;
+    FLAG_SET(state, FLAG_POWER_ON_REQUEST);
 
     return NRF_OK;
 }
@@ -195,7 +400,7 @@ eg_nrf_error_e eg_nrf24l01_wake_up(eg_nrf24l01_state_s *state)
         return NRF_INVALID_ARGUMENT;
     }
 
-    state->wake_up_request = 1u;
+    FLAG_SET(state, FLAG_WAKE_UP_REQUEST);
 
     return NRF_OK;
 }
@@ -207,325 +412,1621 @@ eg_nrf_error_e eg_nrf24l01_sleep(eg_nrf24l01_state_s *state)
         return NRF_INVALID_ARGUMENT;
     }
 
-    state->sleep_request = 1u;
+    FLAG_SET(state, FLAG_SLEEP_REQUEST);
 
     return NRF_OK;
 }
 
-void eg_nrf24l01_spi_comm_complete(eg_nrf24l01_state_s *state,
-                                   uint8_t rx_len)
+void eg_nrf24l01_irq_handler(eg_nrf24l01_state_s *state)
 {
-    state->spi_rx_data_len = rx_len;
-    state->spi_data_ready = 1u;
+    if (NULL == state)
+    {
+        return;
+    }
 
-    if (state->set_csn_callback != NULL)
+    state->irq_time_us = eg_nrf24l01_user_time_us_get();
+    FLAG_SET(state, FLAG_IRQ_PENDING);
+#if EG_NRF24L01_STATS
+    state->stats_irq_ticks = eg_nrf24l01_user_stats_ticks_get();
+    FLAG_SET(state, FLAG_IRQ_STAMPED);
+#endif
+
+    if (1u == state->spi_chaining)
     {
-        state->set_csn_callback(1u);
+        /* Start status read right from the interrupt */
+        sm_run(state);
     }
 }
 
-static void sm_state_power_off_handler(eg_nrf24l01_state_s *state)
+uint8_t eg_nrf24l01_is_idle(eg_nrf24l01_state_s *state)
 {
-    if (1u == state->power_on_request)
+    if (NULL == state)
     {
-        state->timestamp = eg_nrf24l01_user_timestamp_get() + POWER_ON_TIME_MS;
-
-        if (state->set_csn_callback != NULL)
-        {
-            state->set_csn_callback(1u);
-        }
-        if (state->set_ce_callback != NULL)
-        {
-            state->set_ce_callback(0u);
-        }
-
-        /* Power UP the module */
-        state->config_registers.config.pwr_up = 1u;
-
-        spi_write_register(state,
-                           NRF_REG_CONFIG,
-                           &state->config_registers.config.val,
-                           sizeof(state->config_registers.config));
+        return 1u;
+    }
 
-        state->sm_state = NRF_SM_MODULE_STARTUP;
+    switch (state->sm_state)
+    {
+    case NRF_SM_POWER_OFF:
+        return (0u == FLAG_GET(state, FLAG_POWER_ON_REQUEST));
+    case NRF_SM_SLEEP:
+        return (0u == FLAG_GET(state, FLAG_WAKE_UP_REQUEST));
+    case NRF_SM_IDLE:
+        return (NRF_SM_IDLE == idle_next_state(state));
+    default:
+        return 0u;
     }
 }
-static void sm_state_module_startup_handler(eg_nrf24l01_state_s *state)
+
+eg_nrf_power_state_e eg_nrf24l01_power_state_get(eg_nrf24l01_state_s *state)
 {
-    if (1u == state->spi_data_ready)
+    if (NULL == state || NRF_SM_POWER_OFF == state->sm_state || NRF_SM_MODULE_STARTUP == state->sm_state)
     {
-        uint64_t timestamp = eg_nrf24l01_user_timestamp_get();
-        if (timestamp >= state->timestamp)
-        {
-            /* Defined time elapsed */
-            state->sm_state = NRF_SM_CONFIGURE;
-        }
+        return POWER_STATE_OFF;
+    }
+    else if (0u == state->config_registers.config.pwr_up || NRF_SM_POWERING_UP == state->sm_state)
+    {
+        return POWER_STATE_POWER_DOWN;
+    }
+    else if (0u == state->ce_state)
+    {
+        return POWER_STATE_STANDBY_I;
+    }
+    else if (1u == state->config_registers.config.prim_rx)
+    {
+        return POWER_STATE_RX;
+    }
+    else if (0u == state->tx_fifo_level)
+    {
+        return POWER_STATE_STANDBY_II;
+    }
+    else
+    {
+        return POWER_STATE_TX;
     }
 }
-static void sm_state_configure_handler(eg_nrf24l01_state_s *state)
+
+eg_nrf_error_e eg_nrf24l01_send(eg_nrf24l01_state_s *state, const uint8_t *data, uint8_t data_len)
 {
-    /* Set module to RX mode */
-    state->config_registers.config.prim_rx = 1u;
-    /* RX Data Ready interrupt is enabled by default */
-    /* TX Data Sent interrupt is enabled by default */
+    if (NULL == state || NULL == data || 0u == data_len || data_len > EG_NRF24L01_MAX_PAYLOAD_LEN)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
 
-    /* Disable Max Retransmissions interrupt */
-    state->config_registers.config.mask_max_rt = 1u;
-    /* Write config register */
-    spi_write_register(state,
-                       NRF_REG_CONFIG,
-                       &state->config_registers.config.val,
-                       sizeof(state->config_registers.config));
-    while (0u == state->spi_data_ready)
-        ;
+    return tx_queue_put(state, NRF_CMD_W_TX_PAYLOAD, data, data_len);
+}
 
-    /* Configure EN_AA register */
-    spi_write_register(state,
-                       NRF_REG_EN_AA,
-                       &state->config_registers.en_aa.val,
-                       sizeof(state->config_registers.en_aa));
-    while (0u == state->spi_data_ready)
-        ;
+eg_nrf_error_e eg_nrf24l01_send_no_ack(eg_nrf24l01_state_s *state, const uint8_t *data, uint8_t data_len)
+{
+    if (NULL == state || NULL == data || 0u == data_len || data_len > EG_NRF24L01_MAX_PAYLOAD_LEN)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+    if (0u == state->config_registers.feature.en_dyn_ack)
+    {
+        /* W_TX_PAYLOAD_NO_ACK is ignored by the module without EN_DYN_ACK */
+        return NRF_INVALID_ARGUMENT;
+    }
 
-    /* Configure EN_RXADDR register */
-    spi_write_register(state,
-                       NRF_REG_EN_RXADDR,
-                       &state->config_registers.en_rxaddr.val,
-                       sizeof(state->config_registers.en_rxaddr));
-    while (0u == state->spi_data_ready)
-        ;
+    return tx_queue_put(state, NRF_CMD_W_TX_PAYLOAD_NO_ACK, data, data_len);
+}
 
-    /* Configure SETUP_AW register */
-    spi_write_register(state,
-                       NRF_REG_SETUP_AW,
-                       &state->config_registers.setup_aw.val,
-                       sizeof(state->config_registers.setup_aw));
-    while (0u == state->spi_data_ready)
-        ;
+eg_nrf_error_e eg_nrf24l01_tx_pause(eg_nrf24l01_state_s *state, uint8_t pause)
+{
+    if (NULL == state)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
 
-    /* Configure RX_ADDR_P0 register */
-    spi_write_register(state,
-                       NRF_REG_RX_ADDR_P0,
-                       state->config_registers.rx_addr_p0,
-                       sizeof(state->config_registers.rx_addr_p0));
-    while (0u == state->spi_data_ready)
-        ;
-    /* Set RX pipe data length in pipe 0 */
-    spi_write_register(state,
-                       NRF_REG_RX_PW_P0,
-                       &state->config_registers.rx_pw_p0.val,
-                       sizeof(state->config_registers.rx_pw_p0));
-    while (0u == state->spi_data_ready)
-        ;
-    // /* Configure RX_ADDR_P1 register */
-    // spi_write_register(state,
-    //                    NRF_REG_RX_ADDR_P1,
-    //                    state->config_registers.rx_addr_p1,
-    //                    sizeof(state->config_registers.rx_addr_p1));
-    // while (0u == state->spi_data_ready)
-    //     ;
-    // /* Configure RX_ADDR_P2 register */
-    // spi_write_register(state,
-    //                    NRF_REG_RX_ADDR_P2,
-    //                    &state->config_registers.rx_addr_p2,
-    //                    sizeof(state->config_registers.rx_addr_p2));
-    // while (0u == state->spi_data_ready)
-    //     ;
-    // /* Configure RX_ADDR_P3 register */
-    // spi_write_register(state,
-    //                    NRF_REG_RX_ADDR_P3,
-    //                    &state->config_registers.rx_addr_p3,
-    //                    sizeof(state->config_registers.rx_addr_p3));
-    // while (0u == state->spi_data_ready)
-    //     ;
-    // /* Configure RX_ADDR_P4 register */
-    // spi_write_register(state,
-    //                    NRF_REG_RX_ADDR_P4,
-    //                    &state->config_registers.rx_addr_p4,
-    //                    sizeof(state->config_registers.rx_addr_p4));
-    // while (0u == state->spi_data_ready)
-    //     ;
-    // /* Configure RX_ADDR_P5 register */
-    // spi_write_register(state,
-    //                    NRF_REG_RX_ADDR_P5,
-    //                    &state->config_registers.rx_addr_p5,
-    //                    sizeof(state->config_registers.rx_addr_p5));
-    // while (0u == state->spi_data_ready)
-    //     ;
-    /* FLUSH_TX */
-    spi_write_register(state,
-                       NRF_CMD_FLUSH_TX,
-                       NULL,
-                       0u);
-    while (0u == state->spi_data_ready)
-        ;
-    /* FLUSH_RX */
-    spi_write_register(state,
-                       NRF_CMD_FLUSH_RX,
-                       NULL,
-                       0u);
-    while (0u == state->spi_data_ready)
-        ;
+    if (1u == pause)
+    {
+        FLAG_SET(state, FLAG_TX_PAUSED);
+    }
+    else
+    {
+        FLAG_CLEAR(state, FLAG_TX_PAUSED);
+    }
 
-    state->sm_state = NRF_SM_SLEEP;
+    return NRF_OK;
 }
-static void sm_state_sleep_handler(eg_nrf24l01_state_s *state)
+
+uint32_t eg_nrf24l01_rx_timestamp_get(eg_nrf24l01_state_s *state)
 {
-    if (1u == state->wake_up_request)
+    if (NULL == state)
     {
-        state->wake_up_request = 0u;
-        if (state->set_ce_callback != NULL)
-        {
-            state->set_ce_callback(1u);
-        }
-        state->sm_state = NRF_SM_STATUS_READ;
+        return 0u;
+    }
+#if EG_NRF24L01_RX_RING_SIZE > 0u
+    uint8_t tail = state->rx_ring_tail;
+    if (tail == __atomic_load_n(&state->rx_ring_head, __ATOMIC_ACQUIRE))
+    {
+        return 0u;
     }
+    return state->rx_ring[tail & RX_RING_MASK].time_us;
+#else
+    return state->rx_time_us;
+#endif
 }
-static void sm_state_idle_handler(eg_nrf24l01_state_s *state)
+
+eg_nrf_error_e eg_nrf24l01_ack_payload_set(eg_nrf24l01_state_s *state, uint8_t pipe, const uint8_t *data, uint8_t data_len)
 {
-    if (1u == state->config_registers.status.rx_dr)
+    if (NULL == state || NULL == data || 0u == data_len || data_len > EG_NRF24L01_MAX_PAYLOAD_LEN)
     {
-        state->sm_state = NRF_SM_RECEIVE;
-        // są dane do odebrania, zajmij się tym
+        return NRF_INVALID_ARGUMENT;
     }
-    else if(0u == state->config_registers.fifo_status.rx_empty)
+    if (pipe >= EG_NRF24L01_MAX_ADDRESS_NO || 0u == state->config_registers.feature.en_ack_pay)
     {
-        state->sm_state = NRF_SM_RECEIVE;
+        return NRF_INVALID_ARGUMENT;
     }
-    else if (0u == state->get_irq_callback())
+    if (0u == (state->config_registers.dynpd.val & (1u << pipe)))
     {
-        state->sm_state = NRF_SM_STATUS_READ;
+        /* ACK payload works only on pipes with dynamic payload length */
+        return NRF_INVALID_PAYLOAD_WIDTH;
     }
-    else
+
+    return tx_queue_put(state, NRF_CMD_W_ACK_PAYLOAD | pipe, data, data_len);
+}
+
+eg_nrf_error_e eg_nrf24l01_channel_set(eg_nrf24l01_state_s *state, uint8_t channel)
+{
+    if (NULL == state || channel > NRF_MAX_CHANNEL)
     {
+        return NRF_INVALID_ARGUMENT;
     }
+
+    state->config_registers.rf_ch.rf_ch = channel;
+    reg_mark_dirty(state, REG_DIRTY(REG_IDX_RF_CH));
+
+    return NRF_OK;
 }
-static void sm_state_status_read_handler(eg_nrf24l01_state_s *state)
+
+eg_nrf_error_e eg_nrf24l01_rf_set(eg_nrf24l01_state_s *state, eg_nrf_data_rate_e data_rate, eg_nrf_rf_power_e power)
 {
-    spi_read_register(state, NRF_REG_FIFO_STATUS, 1u);
+    if (NULL == state || data_rate > DATA_RATE_250KBPS || power > RF_POWER_0DBM)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
 
-    state->sm_state = NRF_SM_STATUS_READING;
+    state->config_registers.rf_setup.rf_dr_low = (DATA_RATE_250KBPS == data_rate);
+    state->config_registers.rf_setup.rf_dr_high = (DATA_RATE_2MBPS == data_rate);
+    state->config_registers.rf_setup.rf_pwr = (uint8_t)power;
+    reg_mark_dirty(state, REG_DIRTY(REG_IDX_RF_SETUP));
+
+    return NRF_OK;
 }
-static void sm_state_status_reading_handler(eg_nrf24l01_state_s *state)
+
+eg_nrf_error_e eg_nrf24l01_retransmit_set(eg_nrf24l01_state_s *state, uint8_t delay, uint8_t count)
 {
-    if (1u == state->spi_data_ready)
+    if (NULL == state || delay > 15u || count > 15u)
     {
-        state->config_registers.status.val = state->spi_rx_buf[0u];
-        state->config_registers.fifo_status.val = state->spi_rx_buf[1u];
-        state->sm_state = NRF_SM_IDLE;
+        return NRF_INVALID_ARGUMENT;
     }
+
+    state->config_registers.setup_retr.ard = delay;
+    state->config_registers.setup_retr.arc = count;
+    reg_mark_dirty(state, REG_DIRTY(REG_IDX_SETUP_RETR));
+
+    return NRF_OK;
 }
-static void sm_state_receive_handler(eg_nrf24l01_state_s *state)
+
+eg_nrf_error_e eg_nrf24l01_rx_pipe_set(eg_nrf24l01_state_s *state, uint8_t pipe, uint8_t enabled, uint8_t auto_ack)
 {
-    state->curr_rx_pipe = state->config_registers.status.rx_p_no;
-    if(0b111u == state->curr_rx_pipe)
+    if (NULL == state || pipe >= EG_NRF24L01_MAX_ADDRESS_NO)
     {
-        /* RX fifo empty - clear rx_dr bit */
-        
-        state->config_registers.status_out.val = 0u;
-        state->config_registers.status_out.rx_dr = 1u;
-        spi_write_register(state,
-                           NRF_REG_STATUS,
-                           &state->config_registers.status_out.val,
-                           sizeof(state->config_registers.status_out));
-                           
-        state->sm_state = NRF_SM_RECEIVING_CLEAR;
+        return NRF_INVALID_ARGUMENT;
     }
-    else
+    if (1u != auto_ack && 0u != (state->config_registers.dynpd.val & (1u << pipe)))
     {
-        uint8_t register_no = NRF_REG_RX_PW_P0 + state->curr_rx_pipe;
-        spi_read_register(state, register_no, 1u);
-        state->sm_state = NRF_SM_RECEIVING_LENGTH;
+        /* Dynamic payload length works only with auto acknowledge */
+        return NRF_INVALID_PAYLOAD_WIDTH;
     }
+
+    state->config_registers.en_rxaddr.val &= ~(1u << pipe);
+    state->config_registers.en_rxaddr.val |= (1u == enabled) << pipe;
+    state->config_registers.en_aa.val &= ~(1u << pipe);
+    state->config_registers.en_aa.val |= (1u == auto_ack) << pipe;
+    reg_mark_dirty(state, REG_DIRTY(REG_IDX_EN_RXADDR) | REG_DIRTY(REG_IDX_EN_AA));
+
+    return NRF_OK;
 }
-static void sm_state_receiving_length_handler(eg_nrf24l01_state_s *state)
+
+eg_nrf_error_e eg_nrf24l01_rx_address_set(eg_nrf24l01_state_s *state, uint8_t pipe, const uint8_t *address)
 {
-    if (1u == state->spi_data_ready)
+    if (NULL == state || NULL == address || pipe >= EG_NRF24L01_MAX_ADDRESS_NO)
     {
-        uint8_t data_length = state->spi_rx_buf[1u];
-        state->rx_data_len = data_length;
+        return NRF_INVALID_ARGUMENT;
+    }
 
-        spi_read_register(state, NRF_CMD_R_RX_PAYLOAD, state->rx_data_len);
-        state->sm_state = NRF_SM_RECEIVING;
+    if (pipe < 2u)
+    {
+        memcpy(reg_cache(state, REG_IDX_RX_ADDR_P0 + pipe), address, EG_NRF24L01_ADDRESS_MAX_WIDTH);
     }
-}
-static void sm_state_receiving_handler(eg_nrf24l01_state_s *state)
-{
-    if (1u == state->spi_data_ready)
+    else
     {
-        if (state->rx_pipe[state->curr_rx_pipe].rx_callback != NULL)
+        if (0 != memcmp(&state->config_registers.rx_addr_p1[1u], &address[1u], EG_NRF24L01_ADDRESS_MAX_WIDTH - 1u))
         {
-            state->rx_pipe[state->curr_rx_pipe].rx_callback(&state->spi_rx_buf[1],
-                                                            state->rx_data_len);
+            return NRF_INVALID_P2_P5_ADDRESS;
         }
-        state->config_registers.status_out.val = 0u;
-        state->config_registers.status_out.rx_dr = 1u;
-        spi_write_register(state,
-                           NRF_REG_STATUS,
-                           &state->config_registers.status_out.val,
-                           sizeof(state->config_registers.status_out));
-
-        state->sm_state = NRF_SM_RECEIVING_CLEAR;
+        *reg_cache(state, REG_IDX_RX_ADDR_P0 + pipe) = address[0u];
     }
+    reg_mark_dirty(state, REG_DIRTY(REG_IDX_RX_ADDR_P0 + pipe));
+
+    return NRF_OK;
 }
-static void sm_state_receiving_clear_handler(eg_nrf24l01_state_s *state)
+
+eg_nrf_error_e eg_nrf24l01_tx_address_set(eg_nrf24l01_state_s *state, const uint8_t *address)
 {
-    if (1u == state->spi_data_ready)
+    if (NULL == state || NULL == address)
     {
-        state->sm_state = NRF_SM_STATUS_READ;
+        return NRF_INVALID_ARGUMENT;
     }
+
+    memcpy(state->config_registers.tx_addr, address, EG_NRF24L01_ADDRESS_MAX_WIDTH);
+    reg_mark_dirty(state, REG_DIRTY(REG_IDX_TX_ADDR));
+
+    return NRF_OK;
 }
-static void sm_state_transmit_handler(eg_nrf24l01_state_s *state)
+
+eg_nrf_error_e eg_nrf24l01_payload_width_set(eg_nrf24l01_state_s *state, uint8_t pipe, uint8_t payload_width)
 {
-    asm("nop");
+    if (NULL == state || pipe >= EG_NRF24L01_MAX_ADDRESS_NO)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    eg_nrf_error_e err = rx_payload_width_apply(state, pipe, payload_width);
+    if (NRF_OK == err)
+    {
+        reg_mark_dirty(state, REG_DIRTY(REG_IDX_RX_PW_P0 + pipe) | REG_DIRTY(REG_IDX_FEATURE) | REG_DIRTY(REG_IDX_DYNPD));
+    }
+
+    return err;
 }
-static void sm_state_transmitting_handler(eg_nrf24l01_state_s *state)
+
+#if EG_NRF24L01_RX_RING_SIZE > 0u
+eg_nrf_error_e eg_nrf24l01_rx_peek(eg_nrf24l01_state_s *state, uint8_t **data, uint8_t *data_len, uint8_t *pipe)
 {
-    asm("nop");
+    if (NULL == state || NULL == data || NULL == data_len)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    uint8_t tail = state->rx_ring_tail;
+    if (tail == __atomic_load_n(&state->rx_ring_head, __ATOMIC_ACQUIRE))
+    {
+        return NRF_RX_EMPTY;
+    }
+
+    *data = &state->rx_ring[tail & RX_RING_MASK].buf[1u];
+    *data_len = state->rx_ring[tail & RX_RING_MASK].len;
+    if (NULL != pipe)
+    {
+        *pipe = state->rx_ring[tail & RX_RING_MASK].pipe;
+    }
+
+    return NRF_OK;
 }
-static void sm_state_powering_off_handler(eg_nrf24l01_state_s *state)
+
+eg_nrf_error_e eg_nrf24l01_rx_release(eg_nrf24l01_state_s *state)
 {
-    asm("nop");
+    if (NULL == state)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    uint8_t tail = state->rx_ring_tail;
+    if (tail == __atomic_load_n(&state->rx_ring_head, __ATOMIC_ACQUIRE))
+    {
+        return NRF_RX_EMPTY;
+    }
+
+    /* Hand the slot back to the state machine */
+    __atomic_store_n(&state->rx_ring_tail, (uint8_t)(tail + 1u), __ATOMIC_RELEASE);
+
+    return NRF_OK;
 }
+#endif
 
-static void spi_write_register(eg_nrf24l01_state_s *state,
-                               uint8_t reg,
-                               uint8_t *data,
-                               uint8_t data_len)
+#if EG_NRF24L01_STATS
+eg_nrf_error_e eg_nrf24l01_get_stats(eg_nrf24l01_state_s *state, eg_nrf24l01_stats_s *stats)
 {
-    if (state->set_csn_callback != NULL)
+    if (NULL == state || NULL == stats)
     {
-        state->set_csn_callback(0u);
+        return NRF_INVALID_ARGUMENT;
     }
 
-    state->spi_tx_buf[0u] = NRF_CMD_WRITE_REG | reg;
-    memcpy(&state->spi_tx_buf[1u], data, data_len);
+    memcpy(stats, &state->stats, sizeof(eg_nrf24l01_stats_s));
 
-    state->spi_data_ready = 0u;
-    eg_nrf24l01_user_spi_transmit_receive(state,
-                                          state->spi_tx_buf,
-                                          data_len + 1u,
-                                          state->spi_rx_buf,
-                                          data_len + 1u);
+    return NRF_OK;
 }
+#endif
 
-static void spi_read_register(eg_nrf24l01_state_s *state,
-                              uint8_t reg,
-                              uint8_t read_len)
+#if EG_NRF24L01_TRACE_DEPTH > 0u
+uint16_t eg_nrf24l01_trace_dump(eg_nrf24l01_state_s *state, eg_nrf24l01_trace_rec_s *records, uint16_t max_cnt)
 {
-    if (state->set_csn_callback != NULL)
+    if (NULL == state || NULL == records)
     {
-        state->set_csn_callback(0u);
+        return 0u;
     }
 
-    state->spi_tx_buf[0u] = NRF_CMD_READ_REG | reg;
+    uint32_t cnt = __atomic_load_n(&state->trace_cnt, __ATOMIC_ACQUIRE);
+    /* Oldest slot is overwritten by the transaction in progress */
+    uint32_t avail = (cnt < EG_NRF24L01_TRACE_DEPTH - 1u) ? cnt : EG_NRF24L01_TRACE_DEPTH - 1u;
+    uint16_t copy_cnt = (avail < max_cnt) ? (uint16_t)avail : max_cnt;
 
-    state->spi_data_ready = 0u;
-    eg_nrf24l01_user_spi_transmit_receive(state,
-                                          state->spi_tx_buf,
-                                          1u,
-                                          state->spi_rx_buf,
-                                          read_len + 1u);
+    for (uint16_t i = 0u; i < copy_cnt; i++)
+    {
+        records[i] = state->trace[(cnt - copy_cnt + i) & TRACE_MASK];
+    }
+
+    return copy_cnt;
+}
+#endif
+
+#if EG_NRF24L01_SCAN
+eg_nrf_error_e eg_nrf24l01_scan_start(eg_nrf24l01_state_s *state, uint8_t first_channel, uint8_t last_channel, uint8_t samples)
+{
+    if (NULL == state || first_channel > last_channel || last_channel > NRF_MAX_CHANNEL || 0u == samples)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+    if (1u == __atomic_load_n(&state->scan.request, __ATOMIC_ACQUIRE))
+    {
+        return NRF_BUSY;
+    }
+
+    memset(state->scan.occupancy, 0, sizeof(state->scan.occupancy));
+    state->scan.channel = first_channel;
+    state->scan.last_channel = last_channel;
+    state->scan.samples = samples;
+    state->scan.aborted = 0u;
+    __atomic_store_n(&state->scan.request, 1u, __ATOMIC_RELEASE);
+
+    return NRF_OK;
+}
+
+eg_nrf_error_e eg_nrf24l01_scan_result_get(eg_nrf24l01_state_s *state, uint8_t *occupancy)
+{
+    if (NULL == state || NULL == occupancy)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+    if (1u == __atomic_load_n(&state->scan.request, __ATOMIC_ACQUIRE))
+    {
+        return NRF_BUSY;
+    }
+
+    memcpy(occupancy, state->scan.occupancy, sizeof(state->scan.occupancy));
+
+    return (1u == state->scan.aborted) ? NRF_ABORTED : NRF_OK;
+}
+#endif
+
+eg_nrf_error_e eg_nrf24l01_bus_init(eg_nrf24l01_bus_s *bus)
+{
+    if (NULL == bus)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    memset(bus, 0, sizeof(eg_nrf24l01_bus_s));
+
+    return NRF_OK;
+}
+
+eg_nrf_error_e eg_nrf24l01_bus_attach(eg_nrf24l01_bus_s *bus, eg_nrf24l01_state_s *state)
+{
+    if (NULL == bus || NULL == state || NULL != state->bus)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+    if (bus->instance_cnt >= EG_NRF24L01_BUS_MAX_INSTANCES)
+    {
+        return NRF_BUS_FULL;
+    }
+
+    bus->instance[bus->instance_cnt] = state;
+    bus->instance_cnt++;
+    state->bus = bus;
+
+    return NRF_OK;
+}
+
+void eg_nrf24l01_bus_process(eg_nrf24l01_bus_s *bus)
+{
+    if (NULL == bus)
+    {
+        return;
+    }
+
+    for (uint8_t i = 0u; i < bus->instance_cnt; i++)
+    {
+        eg_nrf24l01_process(bus->instance[i]);
+    }
+}
+
+void eg_nrf24l01_spi_comm_complete(eg_nrf24l01_state_s *state,
+                                   uint8_t rx_len)
+{
+    (void)rx_len;
+    if (0u != (FLAG_SET(state, FLAG_SPI_DATA_READY) & FLAG_SPI_DATA_READY))
+    {
+        /* Late completion of a transfer abandoned by timeout recovery - not traced */
+        return;
+    }
+#if EG_NRF24L01_TRACE_DEPTH > 0u
+    trace_complete(state);
+#endif
+
+    if (state->set_csn_callback != NULL)
+    {
+        state->set_csn_callback(1u);
+    }
+
+    if (NULL != state->bus)
+    {
+        /* Hand the bus over to the next waiting instance */
+        bus_release(state);
+    }
+
+    if (1u == state->spi_chaining)
+    {
+        /* Start next transaction of the sequence from completion context */
+        sm_run(state);
+    }
+}
+
+static void sm_state_power_off_handler(eg_nrf24l01_state_s *state)
+{
+    if (1u == FLAG_GET(state, FLAG_POWER_ON_REQUEST))
+    {
+        FLAG_CLEAR(state, FLAG_POWER_ON_REQUEST);
+        state->timestamp = eg_nrf24l01_user_time_us_get() + EG_NRF24L01_POR_DELAY_US;
+
+        if (state->set_csn_callback != NULL)
+        {
+            state->set_csn_callback(1u);
+        }
+        set_ce(state, 0u);
+
+        state->sm_state = NRF_SM_MODULE_STARTUP;
+    }
+}
+static void sm_state_module_startup_handler(eg_nrf24l01_state_s *state)
+{
+    if (1u == time_elapsed(state))
+    {
+        /* Power on reset done - write whole configuration, module stays in power down */
+        state->config_registers.config.pwr_up = 0u;
+        state->config_registers.config.prim_rx = 1u;
+        /* RX Data Ready interrupt is enabled by default */
+        /* TX Data Sent interrupt is enabled by default */
+        /* Max Retransmissions interrupt is enabled by default */
+        state->reg_dirty = REG_DIRTY_ALL;
+        state->sm_state = NRF_SM_CONFIGURE;
+    }
+}
+static void sm_state_configure_handler(eg_nrf24l01_state_s *state)
+{
+    if (0u == FLAG_GET(state, FLAG_SPI_DATA_READY))
+    {
+        /* Previous register write in progress */
+        return;
+    }
+
+    if (0u == reg_flush_next(state))
+    {
+        state->sm_state = NRF_SM_SLEEP;
+        event_signal(state, NRF_EVENT_POWER_ON);
+    }
+}
+static void sm_state_sleep_handler(eg_nrf24l01_state_s *state)
+{
+    if (0u == FLAG_GET(state, FLAG_SPI_DATA_READY))
+    {
+        /* Power down write in progress */
+        return;
+    }
+
+    /* Already sleeping */
+    if (1u == FLAG_GET(state, FLAG_SLEEP_REQUEST))
+    {
+        FLAG_CLEAR(state, FLAG_SLEEP_REQUEST);
+        event_signal(state, NRF_EVENT_POWER_DOWN);
+    }
+
+    if (1u == FLAG_GET(state, FLAG_WAKE_UP_REQUEST))
+    {
+        FLAG_CLEAR(state, FLAG_WAKE_UP_REQUEST);
+        state->config_registers.config.pwr_up = 1u;
+        spi_write_register(state,
+                           NRF_REG_CONFIG,
+                           &state->config_registers.config.val,
+                           sizeof(state->config_registers.config));
+        state->timestamp = eg_nrf24l01_user_time_us_get() + EG_NRF24L01_TPD2STBY_US;
+        state->sm_state = NRF_SM_POWERING_UP;
+    }
+}
+static void sm_state_idle_handler(eg_nrf24l01_state_s *state)
+{
+    eg_nrf24l01_sm_state_e next_state = idle_next_state(state);
+
+    if (NRF_SM_STATUS_READ == next_state)
+    {
+        /* Clear before reading status, so IRQ signalled during the read is not lost */
+        FLAG_CLEAR(state, FLAG_IRQ_PENDING);
+        if (0u == state->irq_driven && 0u == state->config_registers.status.rx_dr)
+        {
+            /* IRQ noticed by polling - stamp of RX_DR left pending by full RX ring is kept */
+            state->irq_time_us = eg_nrf24l01_user_time_us_get();
+        }
+    }
+    else if (NRF_SM_REG_FLUSH == next_state)
+    {
+        /* Module must not send or receive while RF registers change */
+        state->reg_flush_ce = state->ce_state;
+        set_ce(state, 0u);
+    }
+    state->sm_state = next_state;
+}
+static void sm_state_status_read_handler(eg_nrf24l01_state_s *state)
+{
+    if (0u == FLAG_GET(state, FLAG_SPI_DATA_READY))
+    {
+        return;
+    }
+
+    spi_read_register(state, NRF_REG_FIFO_STATUS, 1u);
+
+    state->sm_state = NRF_SM_STATUS_READING;
+}
+static void sm_state_status_reading_handler(eg_nrf24l01_state_s *state)
+{
+    if (1u == FLAG_GET(state, FLAG_SPI_DATA_READY))
+    {
+        state->config_registers.status.val = state->spi_rx_buf[0u];
+        state->config_registers.fifo_status.val = state->spi_rx_buf[1u];
+        STATS_ADD(state, rx_fifo_full, state->config_registers.fifo_status.rx_full);
+        if (1u == state->config_registers.fifo_status.tx_empty)
+        {
+            state->tx_fifo_level = 0u;
+            if (state->tx_unreported > state->config_registers.status.tx_ds)
+            {
+                /* Payloads sent with their TX_DS merged into one - only the pending TX_DS reports one more */
+                tx_report(state, state->tx_unreported - state->config_registers.status.tx_ds, 0u);
+            }
+        }
+        else if (0u == state->config_registers.fifo_status.tx_full && state->tx_fifo_level > EG_NRF24L01_TX_FIFO_DEPTH - 1u)
+        {
+            state->tx_fifo_level = EG_NRF24L01_TX_FIFO_DEPTH - 1u;
+        }
+        state->sm_state = NRF_SM_IDLE;
+    }
+}
+static void sm_state_receive_handler(eg_nrf24l01_state_s *state)
+{
+    /* Every payload of the burst was signalled by the last IRQ */
+    state->rx_time_us = state->irq_time_us;
+
+    /* Clear RX_DR once per burst before draining RX FIFO,
+     * payloads received after this point will set it again */
+    state->config_registers.status_out.val = 0u;
+    state->config_registers.status_out.rx_dr = 1u;
+    spi_write_register(state,
+                       NRF_REG_STATUS,
+                       &state->config_registers.status_out.val,
+                       sizeof(state->config_registers.status_out));
+
+    state->sm_state = NRF_SM_RECEIVING_CLEAR;
+}
+static void sm_state_receiving_length_handler(eg_nrf24l01_state_s *state)
+{
+    if (1u == FLAG_GET(state, FLAG_SPI_DATA_READY))
+    {
+        state->config_registers.status.val = state->spi_rx_buf[0u];
+        uint8_t pipe = state->config_registers.status.rx_p_no;
+        uint8_t data_length = state->spi_rx_buf[1u];
+
+        if (pipe >= EG_NRF24L01_MAX_ADDRESS_NO ||
+            0u != *reg_cache(state, REG_IDX_RX_PW_P0 + pipe) ||
+            0u == rx_ring_free(state))
+        {
+            rx_burst_next(state);
+        }
+        else if (0u == data_length || data_length > EG_NRF24L01_MAX_PAYLOAD_LEN)
+        {
+            /* Corrupted payload width - RX FIFO has to be flushed */
+            spi_write_register(state,
+                               NRF_CMD_FLUSH_RX,
+                               NULL,
+                               0u);
+            /* Fall back to FIFO_STATUS polling */
+            state->sm_state = NRF_SM_STATUS_READ;
+        }
+        else
+        {
+            state->curr_rx_pipe = pipe;
+            state->rx_data_len = data_length;
+            rx_payload_read(state);
+            state->sm_state = NRF_SM_RECEIVING;
+        }
+    }
+}
+static void sm_state_receiving_handler(eg_nrf24l01_state_s *state)
+{
+    if (1u == FLAG_GET(state, FLAG_SPI_DATA_READY))
+    {
+#if EG_NRF24L01_RX_RING_SIZE > 0u
+        uint8_t head = state->rx_ring_head;
+        state->rx_ring[head & RX_RING_MASK].len = state->rx_data_len;
+        state->rx_ring[head & RX_RING_MASK].pipe = state->curr_rx_pipe;
+        state->rx_ring[head & RX_RING_MASK].time_us = state->rx_time_us;
+        /* Publish the slot to the application */
+        __atomic_store_n(&state->rx_ring_head, (uint8_t)(head + 1u), __ATOMIC_RELEASE);
+#else
+        if (state->rx_pipe[state->curr_rx_pipe].rx_callback != NULL)
+        {
+            state->rx_pipe[state->curr_rx_pipe].rx_callback(&state->spi_rx_buf[1],
+                                                            state->rx_data_len);
+        }
+#endif
+        state->rx_cnt++;
+        event_signal(state, NRF_EVENT_RX);
+        STATS_ADD(state, rx_packets, 1u);
+        STATS_ADD(state, rx_pipe_packets[state->curr_rx_pipe], 1u);
+#if EG_NRF24L01_STATS
+        if (1u == FLAG_GET(state, FLAG_IRQ_STAMPED))
+        {
+            /* First payload delivered after IRQ */
+            FLAG_CLEAR(state, FLAG_IRQ_STAMPED);
+            stats_hist_add(state->stats.irq_latency, eg_nrf24l01_user_stats_ticks_get() - state->stats_irq_ticks);
+        }
+#endif
+
+        /* Next command returns STATUS with pipe number of the next payload */
+        if (1u == state->config_registers.feature.en_dpl)
+        {
+            spi_read_register(state, NRF_CMD_R_RX_PL_WID, 1u);
+            state->sm_state = NRF_SM_RECEIVING_LENGTH;
+        }
+        else
+        {
+            spi_write_register(state,
+                               NRF_CMD_NOP,
+                               NULL,
+                               0u);
+            state->sm_state = NRF_SM_RECEIVING_CLEAR;
+        }
+    }
+}
+static void sm_state_receiving_clear_handler(eg_nrf24l01_state_s *state)
+{
+    if (1u == FLAG_GET(state, FLAG_SPI_DATA_READY))
+    {
+        /* STATUS is clocked out during every command byte - no need to read it separately */
+        state->config_registers.status.val = state->spi_rx_buf[0u];
+        state->config_registers.status.rx_dr = 0u;
+        rx_burst_next(state);
+    }
+}
+static void sm_state_transmit_handler(eg_nrf24l01_state_s *state)
+{
+    uint8_t prim_rx_needed = tx_prim_rx_needed(state);
+
+    if ((prim_rx_needed != state->config_registers.config.prim_rx && 0u != state->tx_fifo_level) ||
+        (prim_rx_needed == state->config_registers.config.prim_rx && 1u == FLAG_GET(state, FLAG_TX_PAUSED)))
+    {
+        /* TX paused after the decision in idle state */
+        state->sm_state = NRF_SM_IDLE;
+        return;
+    }
+
+    if (prim_rx_needed != state->config_registers.config.prim_rx)
+    {
+        /* Switch PRX / PTX mode - CE has to be low during mode change */
+        set_ce(state, 0u);
+        state->config_registers.config.prim_rx = prim_rx_needed;
+        spi_write_register(state,
+                           NRF_REG_CONFIG,
+                           &state->config_registers.config.val,
+                           sizeof(state->config_registers.config));
+    }
+    else
+    {
+        /* Write payload directly from the queue slot - rx_len matches tx_len for full duplex SPI drivers,
+         * only STATUS byte is used */
+        uint8_t idx = state->tx_queue_tail & TX_QUEUE_MASK;
+        state->tx_writing = 1u;
+        spi_transfer(state,
+                     state->tx_queue[idx].buf,
+                     state->tx_queue[idx].len + 1u,
+                     state->spi_rx_buf,
+                     state->tx_queue[idx].len + 1u);
+    }
+    state->sm_state = NRF_SM_TRANSMITTING;
+}
+static void sm_state_transmitting_handler(eg_nrf24l01_state_s *state)
+{
+    if (1u == FLAG_GET(state, FLAG_SPI_DATA_READY))
+    {
+        state->config_registers.status.val = state->spi_rx_buf[0u];
+
+        if (1u == state->tx_writing)
+        {
+            state->tx_writing = 0u;
+            __atomic_store_n(&state->tx_queue_tail, (uint8_t)(state->tx_queue_tail + 1u), __ATOMIC_RELEASE);
+            state->tx_fifo_level++;
+            state->tx_unreported++;
+#if EG_NRF24L01_TX_TIMEOUT_US > 0u
+            if (1u == state->tx_fifo_level)
+            {
+                /* FIFO was empty - TX timeout runs from the first payload */
+                state->tx_progress_us = eg_nrf24l01_user_time_us_get();
+            }
+#endif
+            STATS_ADD(state, tx_packets, 1u);
+            state->config_registers.fifo_status.tx_empty = 0u;
+            /* CE is kept high in PTX mode, so FIFO is sent as long as it is not empty */
+            set_ce(state, 1u);
+            state->sm_state = NRF_SM_IDLE;
+        }
+        else if (1u == state->config_registers.config.prim_rx)
+        {
+            /* Back in PRX mode - start listening */
+            set_ce(state, 1u);
+            state->sm_state = NRF_SM_IDLE;
+        }
+        else
+        {
+            /* Switched to PTX mode - fill TX FIFO */
+            state->sm_state = NRF_SM_TRANSMIT;
+        }
+    }
+}
+static void sm_state_transmit_clear_handler(eg_nrf24l01_state_s *state)
+{
+    if (1u == state->config_registers.status.max_rt && 0u == state->config_registers.fifo_status.tx_empty)
+    {
+        /* Drop payloads which reached maximum retransmissions before clearing MAX_RT,
+         * otherwise module would retransmit the same payload again */
+        spi_write_register(state,
+                           NRF_CMD_FLUSH_TX,
+                           NULL,
+                           0u);
+        state->config_registers.fifo_status.tx_empty = 1u;
+        state->tx_fifo_level = 0u;
+        if (state->tx_unreported > state->config_registers.status.tx_ds)
+        {
+            /* Failed payload and the untried ones behind it - payload sent before is reported by TX_DS clear */
+            tx_report(state, 0u, state->tx_unreported - state->config_registers.status.tx_ds);
+        }
+    }
+    else
+    {
+        state->config_registers.status_out.val = 0u;
+        state->config_registers.status_out.tx_ds = state->config_registers.status.tx_ds;
+        state->config_registers.status_out.max_rt = state->config_registers.status.max_rt;
+        spi_write_register(state,
+                           NRF_REG_STATUS,
+                           &state->config_registers.status_out.val,
+                           sizeof(state->config_registers.status_out));
+#if EG_NRF24L01_TX_TIMEOUT_US > 0u
+        state->tx_progress_us = eg_nrf24l01_user_time_us_get();
+#endif
+#if EG_NRF24L01_STATS
+        /* IRQ was caused by TX event - nothing to measure up to payload delivery */
+        FLAG_CLEAR(state, FLAG_IRQ_STAMPED);
+#endif
+#if EG_NRF24L01_STATS || EG_NRF24L01_OBSERVE_TX
+        state->observe_tx_pending = 1u;
+#endif
+        /* Payloads already reported by FIFO_STATUS read or MAX_RT flush are not reported again */
+        uint8_t sent = (state->tx_unreported < state->config_registers.status.tx_ds) ? state->tx_unreported : state->config_registers.status.tx_ds;
+        uint8_t failed = (state->tx_unreported - sent < state->config_registers.status.max_rt) ? state->tx_unreported - sent : state->config_registers.status.max_rt;
+        tx_report(state, sent, failed);
+        state->config_registers.status.tx_ds = 0u;
+        state->config_registers.status.max_rt = 0u;
+    }
+    state->sm_state = NRF_SM_TRANSMIT_CLEARING;
+}
+static void sm_state_transmit_clearing_handler(eg_nrf24l01_state_s *state)
+{
+    if (1u == FLAG_GET(state, FLAG_SPI_DATA_READY))
+    {
+        /* Payload received before the clear keeps IRQ asserted without a new edge */
+        rx_dr_observe(state, state->spi_rx_buf[0u]);
+        state->sm_state = tx_clear_next_state(state);
+#if EG_NRF24L01_STATS || EG_NRF24L01_OBSERVE_TX
+        if (1u == state->observe_tx_pending)
+        {
+            state->observe_tx_pending = 0u;
+            spi_read_register(state, NRF_REG_OBSERVE_TX, 1u);
+            state->sm_state = NRF_SM_OBSERVE_TX_READING;
+        }
+#endif
+    }
+}
+static void sm_state_observe_tx_reading_handler(eg_nrf24l01_state_s *state)
+{
+    if (1u == FLAG_GET(state, FLAG_SPI_DATA_READY))
+    {
+        eg_nrf24l01_observe_tx_reg_s observe_tx = {.val = state->spi_rx_buf[1u]};
+        /* ARC_CNT may already belong to the next payload when TX FIFO holds more of them */
+        state->tx_arc_cnt += observe_tx.arc_cnt;
+#if EG_NRF24L01_STATS
+        state->stats.tx_retransmits += observe_tx.arc_cnt;
+        if (observe_tx.plos_cnt >= state->stats_plos_cnt)
+        {
+            state->stats.tx_lost += observe_tx.plos_cnt - state->stats_plos_cnt;
+        }
+        state->stats_plos_cnt = observe_tx.plos_cnt;
+#endif
+        rx_dr_observe(state, state->spi_rx_buf[0u]);
+        state->sm_state = tx_clear_next_state(state);
+    }
+}
+static void sm_state_reg_flush_handler(eg_nrf24l01_state_s *state)
+{
+    if (0u == FLAG_GET(state, FLAG_SPI_DATA_READY))
+    {
+        return;
+    }
+
+    if (0u == reg_flush_next(state))
+    {
+        set_ce(state, state->reg_flush_ce);
+        state->sm_state = NRF_SM_IDLE;
+    }
+}
+static void sm_state_powering_off_handler(eg_nrf24l01_state_s *state)
+{
+    /* Standby-I first, then power down - registers are kept */
+    set_ce(state, 0u);
+    state->config_registers.config.pwr_up = 0u;
+    spi_write_register(state,
+                       NRF_REG_CONFIG,
+                       &state->config_registers.config.val,
+                       sizeof(state->config_registers.config));
+    state->sm_state = NRF_SM_SLEEP;
+}
+static void sm_state_powering_up_handler(eg_nrf24l01_state_s *state)
+{
+    if (1u == FLAG_GET(state, FLAG_SPI_DATA_READY) && 1u == time_elapsed(state))
+    {
+        /* Oscillator is running (standby-I) - CE high enters RX / TX after Tstby2a (130us)
+         * which is timed by the module itself */
+        set_ce(state, 1u);
+        state->sm_state = NRF_SM_STATUS_READ;
+        event_signal(state, NRF_EVENT_POWER_UP);
+    }
+}
+
+#if EG_NRF24L01_SCAN
+static void sm_state_scan_channel_handler(eg_nrf24l01_state_s *state)
+{
+    /* RF_CH may be written only with CE low */
+    set_ce(state, 0u);
+    uint8_t channel = state->scan.channel;
+    spi_write_register(state,
+                       NRF_REG_RF_CH,
+                       &channel,
+                       sizeof(channel));
+#if EG_NRF24L01_STATS
+    /* RF_CH write resets PLOS_CNT - nothing counted on scanned channels is credited to the operating one */
+    state->stats_plos_cnt = 0u;
+#endif
+    state->scan.sample = 0u;
+    state->sm_state = NRF_SM_SCAN_DWELL;
+}
+static void sm_state_scan_dwell_handler(eg_nrf24l01_state_s *state)
+{
+    if (0u == FLAG_GET(state, FLAG_SPI_DATA_READY))
+    {
+        return;
+    }
+
+    if (0u == state->ce_state)
+    {
+        /* Listen on the channel */
+        set_ce(state, 1u);
+        state->timestamp = eg_nrf24l01_user_time_us_get() + EG_NRF24L01_RPD_DWELL_US;
+    }
+    else if (1u == time_elapsed(state))
+    {
+        /* CE low latches RPD */
+        set_ce(state, 0u);
+        spi_read_register(state, NRF_REG_RPD, 1u);
+        state->sm_state = NRF_SM_SCAN_READING;
+    }
+}
+static void sm_state_scan_reading_handler(eg_nrf24l01_state_s *state)
+{
+    if (0u == FLAG_GET(state, FLAG_SPI_DATA_READY))
+    {
+        return;
+    }
+
+    state->scan.occupancy[state->scan.channel] += state->spi_rx_buf[1u] & 0x01u;
+    state->scan.sample++;
+
+    if (state->scan.sample < state->scan.samples)
+    {
+        state->sm_state = NRF_SM_SCAN_DWELL;
+    }
+    else if (state->scan.channel < state->scan.last_channel)
+    {
+        state->scan.channel++;
+        state->sm_state = NRF_SM_SCAN_CHANNEL;
+    }
+    else
+    {
+        /* Sweep done - restore RF channel through shadow register flush and listen again */
+        reg_mark_dirty(state, REG_DIRTY(REG_IDX_RF_CH));
+        set_ce(state, 1u);
+        __atomic_store_n(&state->scan.request, 0u, __ATOMIC_RELEASE);
+        state->sm_state = NRF_SM_IDLE;
+        event_signal(state, NRF_EVENT_SCAN_DONE);
+    }
+}
+#endif
+
+static void spi_write_register(eg_nrf24l01_state_s *state,
+                               uint8_t reg,
+                               uint8_t *data,
+                               uint8_t data_len)
+{
+    state->spi_tx_buf[0u] = NRF_CMD_WRITE_REG | reg;
+    memcpy(&state->spi_tx_buf[1u], data, data_len);
+
+    spi_transfer(state, state->spi_tx_buf, data_len + 1u, state->spi_rx_buf, data_len + 1u);
+}
+
+static void spi_read_register(eg_nrf24l01_state_s *state,
+                              uint8_t reg,
+                              uint8_t read_len)
+{
+    state->spi_tx_buf[0u] = NRF_CMD_READ_REG | reg;
+
+    spi_transfer(state, state->spi_tx_buf, 1u, state->spi_rx_buf, read_len + 1u);
+}
+
+static void spi_transfer(eg_nrf24l01_state_s *state,
+                         uint8_t *tx_buf,
+                         uint8_t tx_len,
+                         uint8_t *rx_buf,
+                         uint8_t rx_len)
+{
+    STATS_ADD(state, spi_transactions, 1u);
+    STATS_ADD(state, spi_bytes, (tx_len > rx_len) ? tx_len : rx_len);
+
+    FLAG_CLEAR(state, FLAG_SPI_DATA_READY);
+#if EG_NRF24L01_SPI_TIMEOUT_US > 0u
+    state->spi_start_us = eg_nrf24l01_user_time_us_get();
+#endif
+    state->bus_transfer.tx_buf = tx_buf;
+    state->bus_transfer.tx_len = tx_len;
+    state->bus_transfer.rx_buf = rx_buf;
+    state->bus_transfer.rx_len = rx_len;
+
+    if (NULL != state->bus)
+    {
+        /* Transfer is started by whichever context picks it - this one when the bus is free */
+        EG_NRF24L01_ATOMIC_OR(&state->bus_transfer.waiting, 1u);
+        bus_kick(state->bus);
+        return;
+    }
+
+    spi_start(state);
+}
+
+static void spi_start(eg_nrf24l01_state_s *state)
+{
+#if EG_NRF24L01_TRACE_DEPTH > 0u
+    trace_start(state);
+#endif
+    if (state->set_csn_callback != NULL)
+    {
+        state->set_csn_callback(0u);
+    }
+
+    eg_nrf24l01_user_spi_transmit_receive(state,
+                                          state->bus_transfer.tx_buf,
+                                          state->bus_transfer.tx_len,
+                                          state->bus_transfer.rx_buf,
+                                          state->bus_transfer.rx_len);
+}
+
+static void bus_release(eg_nrf24l01_state_s *state)
+{
+    eg_nrf24l01_bus_s *bus = state->bus;
+
+    __atomic_store_n(&bus->owner, NULL, __ATOMIC_SEQ_CST);
+    bus_kick(bus);
+}
+
+static void bus_kick(eg_nrf24l01_bus_s *bus)
+{
+    /* Lock free hand over - any context may pick the next instance, the one which swaps owner
+     * from NULL to BUS_PICKING does it. Waiting is set before the swap attempt and checked
+     * again after an empty pick, so a request made meanwhile is never left behind */
+    for (;;)
+    {
+        /* User IRQ pin callbacks are sampled before the bus is taken */
+        uint32_t service = bus_service_mask(bus);
+        eg_nrf24l01_state_s *next;
+
+        if (0u == EG_NRF24L01_ATOMIC_CAS(&bus->owner, NULL, BUS_PICKING(bus)))
+        {
+            /* Bus is handed over by its owner completion or by the context picking now */
+            return;
+        }
+
+        next = bus_pick(bus, service);
+        if (NULL != next)
+        {
+            __atomic_store_n(&bus->owner, next, __ATOMIC_SEQ_CST);
+            spi_start(next);
+            return;
+        }
+
+        __atomic_store_n(&bus->owner, NULL, __ATOMIC_SEQ_CST);
+        if (0u == bus_waiting(bus))
+        {
+            return;
+        }
+    }
+}
+
+static uint8_t bus_waiting(eg_nrf24l01_bus_s *bus)
+{
+    for (uint8_t i = 0u; i < bus->instance_cnt; i++)
+    {
+        if (1u == __atomic_load_n(&bus->instance[i]->bus_transfer.waiting, __ATOMIC_SEQ_CST))
+        {
+            return 1u;
+        }
+    }
+
+    return 0u;
+}
+
+static uint32_t bus_service_mask(eg_nrf24l01_bus_s *bus)
+{
+    uint32_t service = 0u;
+
+    for (uint8_t i = 0u; i < bus->instance_cnt; i++)
+    {
+        eg_nrf24l01_state_s *candidate = bus->instance[i];
+
+        /* Instance starting to wait after the sample is served in round robin order */
+        if (1u == candidate->bus_transfer.waiting &&
+            (1u == FLAG_GET(candidate, FLAG_IRQ_PENDING) ||
+             1u == candidate->config_registers.fifo_status.rx_full ||
+             (NULL != candidate->get_irq_callback && 0u == candidate->get_irq_callback())))
+        {
+            service |= (uint32_t)1u << i;
+        }
+    }
+
+    return service;
+}
+
+static eg_nrf24l01_state_s *bus_pick(eg_nrf24l01_bus_s *bus, uint32_t service)
+{
+    /* Instances needing service first, then the rest in round robin order.
+     * Waiting flag is claimed atomically - recovery may withdraw the transfer meanwhile */
+    for (uint8_t pass = 0u; pass < 2u; pass++)
+    {
+        for (uint8_t i = 0u; i < bus->instance_cnt; i++)
+        {
+            uint8_t idx = (uint8_t)((bus->rr_next + i) % bus->instance_cnt);
+            eg_nrf24l01_state_s *candidate = bus->instance[idx];
+
+            if (0u == pass && 0u == (service & ((uint32_t)1u << idx)))
+            {
+                continue;
+            }
+            if (0u != (EG_NRF24L01_ATOMIC_AND(&candidate->bus_transfer.waiting, 0u) & 1u))
+            {
+                bus->rr_next = (uint8_t)((idx + 1u) % bus->instance_cnt);
+                return candidate;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+#if EG_NRF24L01_TRACE_DEPTH > 0u
+static void trace_start(eg_nrf24l01_state_s *state)
+{
+    eg_nrf24l01_trace_rec_s *rec = &state->trace[state->trace_cnt & TRACE_MASK];
+    uint8_t len = state->bus_transfer.tx_len;
+
+    rec->timestamp = eg_nrf24l01_user_stats_ticks_get();
+    rec->sm_state = (uint8_t)state->sm_state;
+    rec->tx_len = state->bus_transfer.tx_len;
+    rec->rx_len = state->bus_transfer.rx_len;
+    memcpy(rec->tx, state->bus_transfer.tx_buf, (len < EG_NRF24L01_TRACE_DATA_LEN) ? len : EG_NRF24L01_TRACE_DATA_LEN);
+}
+
+static void trace_complete(eg_nrf24l01_state_s *state)
+{
+    eg_nrf24l01_trace_rec_s *rec = &state->trace[state->trace_cnt & TRACE_MASK];
+    uint8_t len = state->bus_transfer.rx_len;
+
+    memcpy(rec->rx, state->bus_transfer.rx_buf, (len < EG_NRF24L01_TRACE_DATA_LEN) ? len : EG_NRF24L01_TRACE_DATA_LEN);
+    /* Publish the record */
+    __atomic_store_n(&state->trace_cnt, state->trace_cnt + 1u, __ATOMIC_RELEASE);
+}
+#endif
+
+static void set_ce(eg_nrf24l01_state_s *state, uint8_t pin_state)
+{
+    state->ce_state = pin_state;
+    if (state->set_ce_callback != NULL)
+    {
+        state->set_ce_callback(pin_state);
+    }
+}
+
+static uint8_t time_elapsed(eg_nrf24l01_state_s *state)
+{
+    /* Signed difference keeps the comparison valid across timer wrap around */
+    return ((int32_t)(eg_nrf24l01_user_time_us_get() - state->timestamp) >= 0);
+}
+
+static uint8_t tx_queue_count(eg_nrf24l01_state_s *state)
+{
+    return (uint8_t)(__atomic_load_n(&state->tx_queue_head, __ATOMIC_ACQUIRE) - state->tx_queue_tail);
+}
+
+static eg_nrf_error_e tx_queue_put(eg_nrf24l01_state_s *state, uint8_t cmd, const uint8_t *data, uint8_t data_len)
+{
+    uint8_t head = state->tx_queue_head;
+    if ((uint8_t)(head - __atomic_load_n(&state->tx_queue_tail, __ATOMIC_ACQUIRE)) >= EG_NRF24L01_TX_QUEUE_SIZE)
+    {
+        return NRF_TX_QUEUE_FULL;
+    }
+
+    state->tx_queue[head & TX_QUEUE_MASK].buf[0u] = cmd;
+    memcpy(&state->tx_queue[head & TX_QUEUE_MASK].buf[1u], data, data_len);
+    state->tx_queue[head & TX_QUEUE_MASK].len = data_len;
+    /* Publish the slot to the state machine */
+    __atomic_store_n(&state->tx_queue_head, (uint8_t)(head + 1u), __ATOMIC_RELEASE);
+
+    return NRF_OK;
+}
+
+static uint8_t tx_prim_rx_needed(eg_nrf24l01_state_s *state)
+{
+    if (0u == tx_queue_count(state) || 1u == FLAG_GET(state, FLAG_TX_PAUSED))
+    {
+        return 1u;
+    }
+    /* ACK payloads are loaded in PRX mode, other payloads need PTX mode - low command bits are ACK payload pipe */
+    return (NRF_CMD_W_ACK_PAYLOAD == (state->tx_queue[state->tx_queue_tail & TX_QUEUE_MASK].buf[0u] & 0xF8u));
+}
+
+static eg_nrf24l01_sm_state_e tx_clear_next_state(eg_nrf24l01_state_s *state)
+{
+    /* TX_DS is a single sticky bit - payload sent between the last FIFO_STATUS read and the clear
+     * raises no new IRQ, so FIFO_STATUS is read again after every clear while the FIFO may hold payloads */
+    return (0u != state->tx_fifo_level) ? NRF_SM_STATUS_READ : NRF_SM_IDLE;
+}
+
+static void tx_report(eg_nrf24l01_state_s *state, uint8_t sent, uint8_t failed)
+{
+    /* Sent payloads precede failed ones in TX FIFO - events keep that order */
+    state->tx_unreported -= sent + failed;
+    state->tx_ds_cnt += sent;
+    state->tx_max_rt_cnt += failed;
+    STATS_ADD(state, tx_sent, sent);
+    STATS_ADD(state, tx_failed, failed);
+    for (uint8_t i = 0u; i < sent; i++)
+    {
+        event_signal(state, NRF_EVENT_TX_DONE);
+    }
+    for (uint8_t i = 0u; i < failed; i++)
+    {
+        event_signal(state, NRF_EVENT_TX_FAILED);
+    }
+}
+
+static void rx_dr_observe(eg_nrf24l01_state_s *state, uint8_t status)
+{
+    eg_nrf24l01_status_reg_s observed = {.val = status};
+
+    if (1u == observed.rx_dr && 0u == state->config_registers.status.rx_dr)
+    {
+        if (0u == FLAG_GET(state, FLAG_IRQ_PENDING))
+        {
+            /* No IRQ stamp newer than the last status read - payload is stamped now */
+            state->irq_time_us = eg_nrf24l01_user_time_us_get();
+        }
+        state->config_registers.status.rx_dr = 1u;
+    }
+}
+
+static void rx_payload_read(eg_nrf24l01_state_s *state)
+{
+    uint8_t *rx_buf = state->spi_rx_buf;
+#if EG_NRF24L01_RX_RING_SIZE > 0u
+    /* Read payload straight into the free ring slot */
+    rx_buf = state->rx_ring[state->rx_ring_head & RX_RING_MASK].buf;
+#endif
+    state->spi_tx_buf[0u] = NRF_CMD_R_RX_PAYLOAD;
+    spi_transfer(state, state->spi_tx_buf, 1u, rx_buf, state->rx_data_len + 1u);
+}
+
+static void rx_burst_next(eg_nrf24l01_state_s *state)
+{
+    uint8_t pipe = state->config_registers.status.rx_p_no;
+
+    if (pipe >= EG_NRF24L01_MAX_ADDRESS_NO)
+    {
+        /* RX FIFO drained */
+        state->config_registers.fifo_status.rx_empty = 1u;
+        state->sm_state = NRF_SM_IDLE;
+    }
+    else if (0u == rx_ring_free(state))
+    {
+        /* No room for the payload - leave it in RX FIFO until application releases a slot */
+        state->config_registers.fifo_status.rx_empty = 0u;
+        STATS_ADD(state, rx_ring_full, 1u);
+        state->sm_state = NRF_SM_IDLE;
+    }
+    else if (0u == *reg_cache(state, REG_IDX_RX_PW_P0 + pipe))
+    {
+        /* Dynamic payload length - ask module for width of the top payload */
+        spi_read_register(state, NRF_CMD_R_RX_PL_WID, 1u);
+        state->sm_state = NRF_SM_RECEIVING_LENGTH;
+    }
+    else
+    {
+        /* Static payload length - width is known, read payload right away */
+        state->curr_rx_pipe = pipe;
+        state->rx_data_len = *reg_cache(state, REG_IDX_RX_PW_P0 + pipe);
+        rx_payload_read(state);
+        state->sm_state = NRF_SM_RECEIVING;
+    }
+}
+
+static void sm_step(eg_nrf24l01_state_s *state)
+{
+    if (state->sm_state >= NRF_SM_MAX_STATE)
+    {
+        return;
+    }
+    /* Execute state handler */
+    STATS_ADD(state, sm_steps, 1u);
+    if (1u == sm_deadline_check(state))
+    {
+        return;
+    }
+#if EG_NRF24L01_STATS
+    eg_nrf24l01_sm_state_e prev_state = state->sm_state;
+#endif
+    switch (state->sm_state)
+    {
+    /* Per payload states are called directly - compiler can inline them into the step */
+    case NRF_SM_IDLE:
+        sm_state_idle_handler(state);
+        break;
+    case NRF_SM_STATUS_READING:
+        sm_state_status_reading_handler(state);
+        break;
+    case NRF_SM_RECEIVING:
+        sm_state_receiving_handler(state);
+        break;
+    case NRF_SM_TRANSMITTING:
+        sm_state_transmitting_handler(state);
+        break;
+    default:
+        state_handlers_lut[state->sm_state](state);
+        break;
+    }
+#if EG_NRF24L01_STATS
+    if (prev_state != state->sm_state)
+    {
+        uint32_t now = eg_nrf24l01_user_stats_ticks_get();
+        stats_hist_add(state->stats.state_dwell[prev_state], now - state->stats_state_enter);
+        state->stats_state_enter = now;
+    }
+#endif
+}
+
+#if EG_NRF24L01_STATS
+static void stats_hist_add(uint32_t *hist, uint32_t ticks)
+{
+    uint8_t bucket = 0u;
+
+    while (0u != ticks && bucket < EG_NRF24L01_STATS_HIST_BUCKETS - 1u)
+    {
+        ticks >>= 1u;
+        bucket++;
+    }
+    hist[bucket]++;
+}
+#endif
+
+static void sm_run(eg_nrf24l01_state_s *state)
+{
+    if (0u != (FLAG_SET(state, FLAG_SM_ACTIVE) & FLAG_SM_ACTIVE))
+    {
+        /* Interrupted a running state machine - event is picked up by next eg_nrf24l01_process call */
+        return;
+    }
+
+    for (uint8_t i = 0u; i < EG_NRF24L01_CHAIN_MAX_STEPS; i++)
+    {
+        eg_nrf24l01_sm_state_e prev_state = state->sm_state;
+
+        sm_step(state);
+        if (0u == FLAG_GET(state, FLAG_SPI_DATA_READY) || prev_state == state->sm_state)
+        {
+            /* Transfer in flight or nothing to do */
+            break;
+        }
+    }
+
+    FLAG_CLEAR(state, FLAG_SM_ACTIVE);
+}
+
+static eg_nrf24l01_sm_state_e idle_next_state(eg_nrf24l01_state_s *state)
+{
+    /* Paused queue is treated as empty */
+    uint8_t tx_pending = (1u == FLAG_GET(state, FLAG_TX_PAUSED)) ? 0u : tx_queue_count(state);
+    uint8_t tx_prim_rx = tx_prim_rx_needed(state);
+    uint8_t rx_pending = (1u == state->config_registers.status.rx_dr ||
+                          0u == state->config_registers.fifo_status.rx_empty);
+    uint8_t irq_event;
+
+    if (1u == state->irq_driven)
+    {
+        irq_event = FLAG_GET(state, FLAG_IRQ_PENDING);
+    }
+    else
+    {
+        /* IRQ asserted or IRQ pin not available - read module status */
+        irq_event = (NULL == state->get_irq_callback || 0u == state->get_irq_callback());
+    }
+
+    if (1u == rx_pending && 0u != rx_ring_free(state))
+    {
+        // są dane do odebrania, zajmij się tym
+        return NRF_SM_RECEIVE;
+    }
+    else if (1u == state->config_registers.status.tx_ds || 1u == state->config_registers.status.max_rt)
+    {
+        return NRF_SM_TRANSMIT_CLEAR;
+    }
+    else if (0u != state->reg_dirty &&
+             (1u == state->config_registers.config.prim_rx || 0u == state->tx_fifo_level))
+    {
+        /* Write changed registers between packets, PTX waits until TX FIFO is sent */
+        return NRF_SM_REG_FLUSH;
+    }
+    else if (tx_prim_rx != state->config_registers.config.prim_rx && 0u == state->tx_fifo_level)
+    {
+        /* PTX payloads at queue head or everything sent - switch mode once TX FIFO is empty */
+        return NRF_SM_TRANSMIT;
+    }
+    else if (0u != tx_pending && tx_prim_rx == state->config_registers.config.prim_rx &&
+             state->tx_fifo_level < EG_NRF24L01_TX_FIFO_DEPTH && 0u == state->reg_dirty)
+    {
+        /* Keep module TX FIFO filled - changed registers let it drain first */
+        return NRF_SM_TRANSMIT;
+    }
+#if EG_NRF24L01_SCAN
+    else if (1u == state->scan.request && 0u == tx_pending && 1u == state->config_registers.config.prim_rx)
+    {
+        return NRF_SM_SCAN_CHANNEL;
+    }
+#endif
+    else if (1u == FLAG_GET(state, FLAG_SLEEP_REQUEST) && 0u == tx_pending &&
+             (1u == state->config_registers.config.prim_rx || 0u == state->tx_fifo_level))
+    {
+        /* Everything sent - power down */
+        return NRF_SM_POWERING_OFF;
+    }
+    else if (0u == rx_pending && 1u == irq_event)
+    {
+        return NRF_SM_STATUS_READ;
+    }
+    else if (1u == rx_pending && 0u == state->config_registers.config.prim_rx && 0u != state->tx_fifo_level)
+    {
+        /* RX throttled by full RX ring - pending RX_DR keeps IRQ asserted, so PTX status is polled
+         * to clear TX_DS / MAX_RT meanwhile, RX_DR is left pending */
+        return NRF_SM_STATUS_READ;
+    }
+    else
+    {
+        return NRF_SM_IDLE;
+    }
+}
+
+static uint8_t *reg_cache(eg_nrf24l01_state_s *state, uint8_t idx)
+{
+    return (uint8_t *)state + configure_script[idx].offset;
+}
+
+static void reg_mark_dirty(eg_nrf24l01_state_s *state, uint32_t dirty)
+{
+    /* Cache is updated first, so flush never writes stale value */
+    EG_NRF24L01_ATOMIC_OR(&state->reg_dirty, dirty);
+}
+
+static uint8_t reg_flush_next(eg_nrf24l01_state_s *state)
+{
+    uint32_t dirty = __atomic_load_n(&state->reg_dirty, __ATOMIC_ACQUIRE);
+
+    if (0u == dirty)
+    {
+        return 0u;
+    }
+
+    uint8_t idx = (uint8_t)__builtin_ctz(dirty);
+    /* Clear before the write - register changed meanwhile is marked and written again */
+    EG_NRF24L01_ATOMIC_AND(&state->reg_dirty, ~REG_DIRTY(idx));
+    spi_write_register(state,
+                       configure_script[idx].reg,
+                       reg_cache(state, idx),
+                       configure_script[idx].len);
+#if EG_NRF24L01_STATS
+    if (REG_IDX_RF_CH == idx)
+    {
+        /* RF_CH write resets PLOS_CNT */
+        state->stats_plos_cnt = 0u;
+    }
+#endif
+
+    return 1u;
+}
+
+static eg_nrf_error_e rx_payload_width_apply(eg_nrf24l01_state_s *state, uint8_t pipe, uint8_t payload_width)
+{
+    if (payload_width > EG_NRF24L01_MAX_PAYLOAD_LEN)
+    {
+        return NRF_INVALID_PAYLOAD_WIDTH;
+    }
+    else if (0u == payload_width)
+    {
+        /* Dynamic payload length works only with auto acknowledge */
+        if (0u == (state->config_registers.en_aa.val & (1u << pipe)))
+        {
+            return NRF_INVALID_PAYLOAD_WIDTH;
+        }
+        state->config_registers.dynpd.val |= 1u << pipe;
+    }
+    else
+    {
+        state->config_registers.dynpd.val &= ~(1u << pipe);
+    }
+    *reg_cache(state, REG_IDX_RX_PW_P0 + pipe) = payload_width;
+    state->config_registers.feature.en_dpl = (0u != state->config_registers.dynpd.val ||
+                                              1u == state->config_registers.feature.en_ack_pay);
+
+    return NRF_OK;
+}
+
+static uint8_t rx_ring_free(eg_nrf24l01_state_s *state)
+{
+#if EG_NRF24L01_RX_RING_SIZE > 0u
+    return (uint8_t)(EG_NRF24L01_RX_RING_SIZE - (uint8_t)(state->rx_ring_head - __atomic_load_n(&state->rx_ring_tail, __ATOMIC_ACQUIRE)));
+#else
+    (void)state;
+    return 1u;
+#endif
+}
+
+static uint8_t sm_deadline_check(eg_nrf24l01_state_s *state)
+{
+#if EG_NRF24L01_SPI_TIMEOUT_US > 0u
+    if (0u == FLAG_GET(state, FLAG_SPI_DATA_READY))
+    {
+        if (eg_nrf24l01_user_time_us_get() - state->spi_start_us > EG_NRF24L01_SPI_TIMEOUT_US)
+        {
+            state->spi_timeout_cnt++;
+            sm_recover(state);
+            return 1u;
+        }
+        return 0u;
+    }
+#endif
+#if EG_NRF24L01_TX_TIMEOUT_US > 0u
+    /* PTX FIFO is sent within ARC * ARD, ACK payloads of PRX wait for the peer */
+    if (NRF_SM_IDLE == state->sm_state && 0u != state->tx_fifo_level &&
+        0u == state->config_registers.config.prim_rx && 1u == state->ce_state &&
+        eg_nrf24l01_user_time_us_get() - state->tx_progress_us > EG_NRF24L01_TX_TIMEOUT_US)
+    {
+        state->tx_timeout_cnt++;
+        sm_recover(state);
+        return 1u;
+    }
+#endif
+    (void)state;
+    return 0u;
+}
+
+#if EG_NRF24L01_SPI_TIMEOUT_US > 0u || EG_NRF24L01_TX_TIMEOUT_US > 0u
+static void sm_recover(eg_nrf24l01_state_s *state)
+{
+    uint8_t in_flight;
+
+    /* Abandon the transfer in progress - module state is unknown, so it is powered down,
+     * its FIFOs are flushed and the whole configuration is written again */
+    if (state->set_csn_callback != NULL)
+    {
+        state->set_csn_callback(1u);
+    }
+    set_ce(state, 0u);
+
+    /* Transfer is claimed first - late completion returns without touching the state */
+    in_flight = (0u == (FLAG_SET(state, FLAG_SPI_DATA_READY) & FLAG_SPI_DATA_READY));
+
+    if (NULL != state->bus)
+    {
+        /* Withdraw the waiting transfer first, so no other context starts it afterwards */
+        if (0u != (EG_NRF24L01_ATOMIC_AND(&state->bus_transfer.waiting, 0u) & 1u))
+        {
+            /* Transfer was never started */
+            in_flight = 0u;
+        }
+    }
+    if (1u == in_flight && NULL != state->spi_abort_callback)
+    {
+        /* SPI buffers are reused by the configuration - stop DMA still writing spi_rx_buf */
+        state->spi_abort_callback(state);
+    }
+    if (NULL != state->bus && state == __atomic_load_n(&state->bus->owner, __ATOMIC_SEQ_CST))
+    {
+        bus_release(state);
+    }
+
+    /* Payload being written stays in TX queue and is written again */
+    state->tx_writing = 0u;
+    state->observe_tx_pending = 0u;
+    state->tx_fifo_level = 0u;
+    /* Payloads in module TX FIFO are flushed by the configuration */
+    tx_report(state, 0u, state->tx_unreported);
+    state->config_registers.status.val = 0u;
+    state->config_registers.fifo_status.val = 0u;
+    state->config_registers.fifo_status.rx_empty = 1u;
+    state->config_registers.fifo_status.tx_empty = 1u;
+#if EG_NRF24L01_SCAN
+    if (1u == state->scan.request)
+    {
+        /* Sweep ends with partial results - RF channel is restored by the configuration */
+        state->scan.aborted = 1u;
+        __atomic_store_n(&state->scan.request, 0u, __ATOMIC_RELEASE);
+        event_signal(state, NRF_EVENT_SCAN_DONE);
+    }
+#endif
+
+    if (1u == state->config_registers.config.pwr_up)
+    {
+        /* Module was awake - wake it up again once configured */
+        FLAG_SET(state, FLAG_WAKE_UP_REQUEST);
+    }
+    state->config_registers.config.pwr_up = 0u;
+    state->config_registers.config.prim_rx = 1u;
+    EG_NRF24L01_ATOMIC_OR(&state->reg_dirty, REG_DIRTY_ALL);
+    state->sm_state = NRF_SM_CONFIGURE;
+
+    event_signal(state, NRF_EVENT_RECOVERY);
+}
+#endif
+
+static void event_signal(eg_nrf24l01_state_s *state, eg_nrf_event_e event)
+{
+    /* Called from state machine context - callback may set requests, but must not run
+     * eg_nrf24l01_process itself. With SPI chaining this is the completion / IRQ context,
+     * so it must not queue payloads either - TX queue has a single producer */
+    if (state->event_callback != NULL)
+    {
+        state->event_callback(state, event);
+    }
 }
 
 /**
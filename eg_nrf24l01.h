@@ -9,15 +9,19 @@
  * 
  */
 
-#define EG_NRF24L01_MAX_ADDRESS_NO 6u /**< Maximum address index */
-
 /** NRF24L01 error codes */
 typedef enum
 {
     NRF_OK = 0,                       /**< NRF No error*/
     NRF_INVALID_ADDRESS_WIDTH = -100, /**< Invalid given address width */
     NRF_INVALID_ARGUMENT,             /**< Invalid function argument */
-    NRF_INVALID_P2_P5_ADDRESS,        /**< 4 MSB's of P2-P5 address must be the same as 4 MSB's of P1 address */
+    NRF_INVALID_P2_P5_ADDRESS,        /**< 4 MSB's of P2-P5 address (address[1..4]) must be the same as 4 MSB's of P1 address */
+    NRF_TX_QUEUE_FULL,                /**< No free space in TX queue */
+    NRF_RX_EMPTY,                     /**< No received payload available */
+    NRF_INVALID_PAYLOAD_WIDTH,        /**< Payload width above 32 bytes or dynamic width without auto acknowledge */
+    NRF_BUS_FULL,                     /**< No free instance slot on shared SPI bus */
+    NRF_BUSY,                         /**< Requested operation still in progress */
+    NRF_ABORTED,                      /**< Operation abandoned by timeout recovery */
 } eg_nrf_error_e;
 
 /** NRF24L01 initialisation address width field value */
@@ -28,30 +32,83 @@ typedef enum
     ADDRESS_WIDTH_5_BYTES = 3  /**< Address width : 5 bytes */
 } eg_nrf_address_width_e;
 
+/** NRF24L01 air data rate */
+typedef enum
+{
+    DATA_RATE_1MBPS = 0,  /**< Data rate : 1 Mbps */
+    DATA_RATE_2MBPS = 1,  /**< Data rate : 2 Mbps */
+    DATA_RATE_250KBPS = 2 /**< Data rate : 250 kbps */
+} eg_nrf_data_rate_e;
+
+/** NRF24L01 TX output power */
+typedef enum
+{
+    RF_POWER_M18DBM = 0, /**< Output power : -18 dBm */
+    RF_POWER_M12DBM = 1, /**< Output power : -12 dBm */
+    RF_POWER_M6DBM = 2,  /**< Output power : -6 dBm */
+    RF_POWER_0DBM = 3    /**< Output power : 0 dBm */
+} eg_nrf_rf_power_e;
+
+/** NRF24L01 module power state */
+typedef enum
+{
+    POWER_STATE_OFF = 0,        /**< Module not configured yet, state unknown */
+    POWER_STATE_POWER_DOWN = 1, /**< Power down - registers kept, oscillator off */
+    POWER_STATE_STANDBY_I = 2,  /**< Standby-I - CE low, oscillator running */
+    POWER_STATE_STANDBY_II = 3, /**< Standby-II - PTX with CE high and empty TX FIFO */
+    POWER_STATE_RX = 4,         /**< RX mode - listening */
+    POWER_STATE_TX = 5          /**< TX mode - TX FIFO not empty */
+} eg_nrf_power_state_e;
+
 /** NRF24L01 initialization structure */
 typedef struct
 {
     eg_nrf_address_width_e address_width; /**< RX/TX Address field width */
     struct
     {
-        uint8_t address[EG_NRF24L01_ADDRESS_MAX_WIDTH]; /**< RX address bytes */
+        uint8_t address[EG_NRF24L01_ADDRESS_MAX_WIDTH]; /**< RX address bytes, LSByte first */
         uint8_t enabled;                                /**< Enable RX address */
         uint8_t auto_ack;                               /**< Enable auto acknowledge */
-        eg_nrf_rx_callback rx_callback;                 /**< User function callback to handle incomming data */
+        uint8_t payload_width;                          /**< Static payload width (1 - 32), 0 - dynamic payload length (requires auto_ack) */
+        eg_nrf_rx_callback rx_callback;                 /**< User function callback to handle incomming data - not used with RX ring */
     } rx_pipe[EG_NRF24L01_MAX_ADDRESS_NO];              /**< RX addresses */
+    uint8_t tx_address[EG_NRF24L01_ADDRESS_MAX_WIDTH];  /**< TX address - PIPE 0 address must match it to receive auto acknowledge */
     eg_nrf_set_pin_state_callback set_ce_callback;      /**< User callback for setting CE pin state */
     eg_nrf_set_pin_state_callback set_csn_callback;     /**< User callback for setting CSn pin state */
-    eg_nrf_get_pin_state_callback ger_irq_callback;     /**< User callback for getting IRQ pin state */
+    eg_nrf_get_pin_state_callback ger_irq_callback;     /**< User callback for getting IRQ pin state - if NULL module status is polled over SPI */
+    eg_nrf_event_callback event_callback;               /**< User callback for driver events - called from state machine context, optional, must not call send functions with spi_chaining */
+    uint8_t use_irq_handler;                            /**< IRQ is signalled with eg_nrf24l01_irq_handler, IRQ pin is not polled */
+    uint8_t ack_payload;                                /**< Enable payloads attached to auto acknowledge - used pipes need dynamic payload length */
+    uint8_t no_ack;                                     /**< Enable payloads sent without auto acknowledge - eg_nrf24l01_send_no_ack */
+    uint8_t spi_chaining;                               /**< Next SPI transaction is started from eg_nrf24l01_spi_comm_complete / eg_nrf24l01_irq_handler context */
+    eg_nrf_spi_abort_callback spi_abort_callback;       /**< User callback stopping the SPI transfer abandoned by timeout recovery (e.g. DMA) - no completion and no rx_buf write may follow its return, optional for blocking SPI drivers */
 } eg_nrf24l01_init_data_s;
 
+/**
+ * Initializer of RX / TX address, LSByte first
+ * @brief Number of MSBytes is checked at compile time - exactly 4 have to follow the LSByte.
+ * P2-P5 addresses built from the P1 MSBytes macro match P1 by construction - e.g.
+ * EG_NRF24L01_ADDRESS(0xC3u, BASE) with BASE defined as 4 MSBytes, LSByte side first.
+ * MSBytes are not compared at compile time, P2-P5 written with other MSBytes
+ * are still rejected by eg_nrf24l01_init with NRF_INVALID_P2_P5_ADDRESS.
+ */
+#define EG_NRF24L01_ADDRESS(lsb, ...)                                                                  \
+    {(uint8_t)((lsb) + 0u * sizeof(struct {                                                            \
+         _Static_assert(sizeof((uint8_t[]){__VA_ARGS__}) == EG_NRF24L01_ADDRESS_MAX_WIDTH - 1u,        \
+                        "EG_NRF24L01_ADDRESS needs LSByte followed by 4 MSBytes");                     \
+         uint8_t lsb_;                                                                                 \
+     })),                                                                                              \
+     __VA_ARGS__}
+
 /**
  * Function to configure NRF24L01 module driver instance
+ * @brief Initialization data is only read - it can be a const object kept in flash.
  *
  * @param state pointer to internal driver state object
  * @param init_data pointer to initialization data object
  * @return eg_nrf_error_e error code
  */
-extern eg_nrf_error_e eg_nrf24l01_init(eg_nrf24l01_state_s *state, eg_nrf24l01_init_data_s *init_data);
+extern eg_nrf_error_e eg_nrf24l01_init(eg_nrf24l01_state_s *state, const eg_nrf24l01_init_data_s *init_data);
 
 /**
  * Function to process state machine of given driver instance
@@ -61,7 +118,8 @@ extern eg_nrf_error_e eg_nrf24l01_init(eg_nrf24l01_state_s *state, eg_nrf24l01_i
 extern void eg_nrf24l01_process(eg_nrf24l01_state_s *state);
 
 /**
- * Function to Power On the module
+ * Function to Power On the module.
+ * @brief Module is configured after EG_NRF24L01_POR_DELAY_US and left in power down (sleep).
  * 
  * @param state pointer to internal driver state object
  * @return eg_nrf_error_e error code
@@ -69,7 +127,9 @@ extern void eg_nrf24l01_process(eg_nrf24l01_state_s *state);
 extern eg_nrf_error_e eg_nrf24l01_power_on(eg_nrf24l01_state_s *state);
 
 /**
- * Function to Wake up the module
+ * Function to Wake up the module.
+ * @brief Module is powered up and CE is raised after Tpd2stby (EG_NRF24L01_TPD2STBY_US),
+ * so the first packet can be sent or received about 1.7 ms after the call.
  * 
  * @param state pointer to internal driver state object
  * @return eg_nrf_error_e error code
@@ -77,7 +137,9 @@ extern eg_nrf_error_e eg_nrf24l01_power_on(eg_nrf24l01_state_s *state);
 extern eg_nrf_error_e eg_nrf24l01_wake_up(eg_nrf24l01_state_s *state);
 
 /**
- * Function to Sleep the module
+ * Function to Sleep the module.
+ * @brief Module goes to power down once TX queue and module TX FIFO are sent,
+ * received payloads are read out first.
  * 
  * @param state pointer to internal driver state object
  * @return eg_nrf_error_e error code
@@ -85,17 +147,312 @@ extern eg_nrf_error_e eg_nrf24l01_wake_up(eg_nrf24l01_state_s *state);
 extern eg_nrf_error_e eg_nrf24l01_sleep(eg_nrf24l01_state_s *state);
 
 /**
- * User function to get timestamp in ms.
+ * Function to signal IRQ pin falling edge.
+ * @brief Safe to call from interrupt context. Used when use_irq_handler is set in init data.
+ *
+ * @param state pointer to internal driver state object
+ */
+extern void eg_nrf24l01_irq_handler(eg_nrf24l01_state_s *state);
+
+/**
+ * Function to check if driver waits for an external event only.
+ * @brief When it returns 1 eg_nrf24l01_process has nothing to do until next IRQ, SPI completion
+ * or API call, so MCU may enter sleep. Check it with interrupts disabled to not miss a wake up.
+ *
+ * @param state pointer to internal driver state object
+ * @return uint8_t 1 - driver idle, 0 - driver busy
+ */
+extern uint8_t eg_nrf24l01_is_idle(eg_nrf24l01_state_s *state);
+
+/**
+ * Function to get module power state derived from the driver state
+ *
+ * @param state pointer to internal driver state object
+ * @return eg_nrf_power_state_e module power state
+ */
+extern eg_nrf_power_state_e eg_nrf24l01_power_state_get(eg_nrf24l01_state_s *state);
+
+/**
+ * Function to queue payload for transmission.
+ * @brief Payload is copied to the software TX queue and sent by the state machine.
+ * Module is switched to PTX mode until the queue is drained and then back to PRX mode.
+ *
+ * @param state pointer to internal driver state object
+ * @param data pointer to payload
+ * @param data_len payload length (1 - 32 bytes)
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_send(eg_nrf24l01_state_s *state, const uint8_t *data, uint8_t data_len);
+
+/**
+ * Function to queue payload for transmission without auto acknowledge.
+ * @brief Receiver does not answer the payload, TX_DS is signalled at the end of transmission.
+ * Payloads can be mixed with eg_nrf24l01_send ones, CE stays high while the queue is not empty.
+ *
+ * @param state pointer to internal driver state object
+ * @param data pointer to payload
+ * @param data_len payload length (1 - 32 bytes)
+ * @return eg_nrf_error_e error code, NRF_INVALID_ARGUMENT - no_ack not enabled in init data
+ */
+extern eg_nrf_error_e eg_nrf24l01_send_no_ack(eg_nrf24l01_state_s *state, const uint8_t *data, uint8_t data_len);
+
+#if EG_NRF24L01_RX_RING_SIZE > 0u
+/**
+ * Function to get the oldest received payload from the RX ring without copying.
+ * @brief Payload stays valid until eg_nrf24l01_rx_release is called.
+ * May be called from other context than eg_nrf24l01_process (single consumer).
+ *
+ * @param state pointer to internal driver state object
+ * @param data pointer to be set to payload data
+ * @param data_len pointer to be set to payload length
+ * @param pipe pointer to be set to pipe number, may be NULL
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_rx_peek(eg_nrf24l01_state_s *state, uint8_t **data, uint8_t *data_len, uint8_t *pipe);
+
+/**
+ * Function to return the oldest RX ring slot to the driver.
+ *
+ * @param state pointer to internal driver state object
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_rx_release(eg_nrf24l01_state_s *state);
+#endif
+
+/**
+ * Function to hold / release transmission of queued payloads.
+ * @brief Payloads already written to module TX FIFO are still sent, queued ones wait
+ * and module stays in PRX mode while paused.
+ *
+ * @param state pointer to internal driver state object
+ * @param pause 1 - keep payloads in TX queue, 0 - send them
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_tx_pause(eg_nrf24l01_state_s *state, uint8_t pause);
+
+/**
+ * Function to get receive timestamp of a payload.
+ * @brief Payloads are stamped with eg_nrf24l01_user_time_us_get at the IRQ which signalled them
+ * (taken in eg_nrf24l01_irq_handler, or when IRQ pin / status poll noticed it without use_irq_handler).
+ * IRQ is raised at the end of the received packet, payloads queued behind it in RX FIFO get the same stamp.
+ * Returns stamp of the payload given to rx_callback when called from it,
+ * or of the payload returned by eg_nrf24l01_rx_peek with RX ring enabled.
+ * RX_DR seen in STATUS of a TX clear, without a new IRQ, is stamped when it is seen.
+ *
+ * @param state pointer to internal driver state object
+ * @return uint32_t receive time in us, 0 with RX ring empty
+ */
+extern uint32_t eg_nrf24l01_rx_timestamp_get(eg_nrf24l01_state_s *state);
+
+/**
+ * Function to preload payload sent with the next auto acknowledge on given pipe.
+ * @brief Payload goes through the TX queue and is written to module in PRX mode.
+ * On PTX side received ACK payloads are delivered on pipe 0 like any other payload.
+ * Up to three ACK payloads can wait in module TX FIFO.
+ *
+ * @param state pointer to internal driver state object
+ * @param pipe pipe number the acknowledge is sent on
+ * @param data pointer to payload
+ * @param data_len payload length (1 - 32 bytes)
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_ack_payload_set(eg_nrf24l01_state_s *state, uint8_t pipe, const uint8_t *data, uint8_t data_len);
+
+/**
+ * Runtime configuration setters.
+ * @brief Setters only update the register cache and mark the register dirty.
+ * State machine writes dirty registers between packets - one write per register
+ * no matter how many times it was changed, CE is held low during the writes.
+ * Called before eg_nrf24l01_power_on they change the initial configuration,
+ * changes made in sleep are written after wake up.
+ */
+
+/**
+ * Function to set RF channel
+ *
+ * @param state pointer to internal driver state object
+ * @param channel RF channel (0 - 125), frequency is 2400 + channel MHz
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_channel_set(eg_nrf24l01_state_s *state, uint8_t channel);
+
+/**
+ * Function to set air data rate and TX output power
+ *
+ * @param state pointer to internal driver state object
+ * @param data_rate air data rate
+ * @param power TX output power
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_rf_set(eg_nrf24l01_state_s *state, eg_nrf_data_rate_e data_rate, eg_nrf_rf_power_e power);
+
+/**
+ * Function to set automatic retransmission
+ *
+ * @param state pointer to internal driver state object
+ * @param delay retransmit delay (0 - 15), (delay + 1) * 250us
+ * @param count retransmit count (0 - 15), 0 - disabled
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_retransmit_set(eg_nrf24l01_state_s *state, uint8_t delay, uint8_t count);
+
+/**
+ * Function to enable / disable RX pipe and its auto acknowledge
+ *
+ * @param state pointer to internal driver state object
+ * @param pipe pipe number
+ * @param enabled enable RX address
+ * @param auto_ack enable auto acknowledge - required by dynamic payload length
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_rx_pipe_set(eg_nrf24l01_state_s *state, uint8_t pipe, uint8_t enabled, uint8_t auto_ack);
+
+/**
+ * Function to set RX pipe address
+ * @brief Address bytes are LSByte first. Pipes 2 - 5 use only the first (LSByte) address byte,
+ * the rest has to match pipe 1 address.
+ *
+ * @param state pointer to internal driver state object
+ * @param pipe pipe number
+ * @param address pointer to address bytes
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_rx_address_set(eg_nrf24l01_state_s *state, uint8_t pipe, const uint8_t *address);
+
+/**
+ * Function to set TX address
+ *
+ * @param state pointer to internal driver state object
+ * @param address pointer to address bytes
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_tx_address_set(eg_nrf24l01_state_s *state, const uint8_t *address);
+
+/**
+ * Function to set RX pipe payload width
+ *
+ * @param state pointer to internal driver state object
+ * @param pipe pipe number
+ * @param payload_width static payload width (1 - 32), 0 - dynamic payload length (requires auto_ack)
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_payload_width_set(eg_nrf24l01_state_s *state, uint8_t pipe, uint8_t payload_width);
+
+#if EG_NRF24L01_SCAN
+/**
+ * Function to start RPD (received power detector) sweep over RF channels.
+ * @brief Sweep runs in the state machine in PRX mode once TX queue is empty. For every sample
+ * module listens for EG_NRF24L01_RPD_DWELL_US and RPD is read, so one channel takes about
+ * samples * 200us - a full sweep with 4 samples lasts roughly 100 ms. Payloads queued meanwhile
+ * wait for the sweep end, RF channel is restored afterwards. Scanning one channel works as carrier detect.
+ *
+ * @param state pointer to internal driver state object
+ * @param first_channel first scanned channel (0 - 125)
+ * @param last_channel last scanned channel (first_channel - 125)
+ * @param samples RPD samples per channel (1 - 255)
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_scan_start(eg_nrf24l01_state_s *state, uint8_t first_channel, uint8_t last_channel, uint8_t samples);
+
+/**
+ * Function to get result of the last RPD sweep
+ *
+ * @param state pointer to internal driver state object
+ * @param occupancy pointer to EG_NRF24L01_CHANNEL_CNT bytes filled with number of samples
+ * with received power above -64 dBm per channel (channels outside the sweep are 0)
+ * @return eg_nrf_error_e error code, NRF_BUSY while the sweep is running,
+ * NRF_ABORTED when recovery ended it early (channels not reached yet are 0)
+ */
+extern eg_nrf_error_e eg_nrf24l01_scan_result_get(eg_nrf24l01_state_s *state, uint8_t *occupancy);
+#endif
+
+/**
+ * Function to initialize shared SPI bus arbiter
+ *
+ * @param bus pointer to bus arbiter object
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_bus_init(eg_nrf24l01_bus_s *bus);
+
+/**
+ * Function to attach driver instance to shared SPI bus.
+ * @brief Transfers of attached instances are serialized, instances with pending IRQ
+ * or full RX FIFO are served first and the rest in round robin order.
+ * Has to be called after eg_nrf24l01_init. Instances not attached to any bus,
+ * or attached to separate buses, transfer in parallel.
+ *
+ * @param bus pointer to bus arbiter object
+ * @param state pointer to internal driver state object
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_bus_attach(eg_nrf24l01_bus_s *bus, eg_nrf24l01_state_s *state);
+
+/**
+ * Function to process state machines of all instances attached to the bus
+ *
+ * @param bus pointer to bus arbiter object
+ */
+extern void eg_nrf24l01_bus_process(eg_nrf24l01_bus_s *bus);
+
+#if EG_NRF24L01_STATS
+/**
+ * Function to get snapshot of driver statistics.
+ * @brief Counters are updated by the state machine, for a consistent snapshot
+ * call it from the eg_nrf24l01_process context.
+ *
+ * @param state pointer to internal driver state object
+ * @param stats pointer to statistics output
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_get_stats(eg_nrf24l01_state_s *state, eg_nrf24l01_stats_s *stats);
+
+#endif
+
+#if EG_NRF24L01_TRACE_DEPTH > 0u
+/**
+ * Function to copy the most recent SPI transaction trace records.
+ * @brief Records are copied oldest first, the transaction in progress is not included.
+ * Trace keeps running, for a consistent dump call it from the eg_nrf24l01_process context.
+ *
+ * @param state pointer to internal driver state object
+ * @param records pointer to output records array
+ * @param max_cnt size of output records array
+ * @return uint16_t number of copied records
+ */
+extern uint16_t eg_nrf24l01_trace_dump(eg_nrf24l01_state_s *state, eg_nrf24l01_trace_rec_s *records, uint16_t max_cnt);
+#endif
+
+#if EG_NRF24L01_STATS || EG_NRF24L01_TRACE_DEPTH > 0u
+/**
+ * User function to get free running ticks for statistics histograms and trace timestamps.
+ * @brief User must define it somwhere in own code when EG_NRF24L01_STATS or EG_NRF24L01_TRACE_DEPTH is enabled.
+ * Any resolution may be used (e.g. us timer or CPU cycle counter), wrap around is handled.
+ *
+ * @return uint32_t current ticks value.
+ */
+extern uint32_t eg_nrf24l01_user_stats_ticks_get(void);
+#endif
+
+/**
+ * User function to get timestamp in us.
  * @brief User must define it somwhere in own code.
+ * Free running 32 bit counter, wrap around is handled.
  *
- * @return uint64_t current time in milliseconds.
+ * @return uint32_t current time in microseconds.
  */
-extern uint64_t eg_nrf24l01_user_timestamp_get(void);
+extern uint32_t eg_nrf24l01_user_time_us_get(void);
 
 /**
  * User function to handle SPI data transmit / receive.
  * @brief User must define it somwhere in own code.
  * Function should not exceed rx buf length.
+ * rx_len is never below tx_len, so a full duplex transfer of rx_len bytes fits rx_buf.
+ * tx_buf holds only tx_len bytes - bytes clocked past tx_len must be NOP fillers (0xFF)
+ * generated by the driver (e.g. DMA from a fixed filler byte), never read from tx_buf.
+ * eg_nrf24l01_spi_comm_complete may be called before this function returns,
+ * so blocking SPI drivers and host side module models are supported as well.
+ * Transfer abandoned after EG_NRF24L01_SPI_TIMEOUT_US is stopped with spi_abort_callback before
+ * the buffers are reused, its late eg_nrf24l01_spi_comm_complete is ignored.
  *
  * @param state pointer to internal driver state object
  * @param tx_buf pointer to tx data buffer
@@ -112,6 +469,8 @@ extern void eg_nrf24l01_user_spi_transmit_receive(eg_nrf24l01_state_s *state,
 
 /**
  * Function to handle SPI transmit / receive data complete event
+ * @brief With spi_chaining enabled it starts the next transaction of the sequence,
+ * so it has to be called from a context allowed to call eg_nrf24l01_user_spi_transmit_receive.
  *
  * @param state pointer to internal driver state object given by eg_nrf24l01_user_spi_transmit_receive function
  * @param rx_len length of data read from SPI
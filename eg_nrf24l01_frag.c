@@ -0,0 +1,459 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "eg_nrf24l01_frag.h"
+
+/**
+ * @addtogroup NRF24L01_frag
+ * @{
+ *
+ */
+
+_Static_assert(EG_NRF24L01_FRAG_WINDOW >= 1u && EG_NRF24L01_FRAG_WINDOW <= 32u, "EG_NRF24L01_FRAG_WINDOW must be 1 - 32");
+_Static_assert((EG_NRF24L01_FRAG_MAX_FRAGMENTS % 8u) == 0u, "EG_NRF24L01_FRAG_MAX_FRAGMENTS must be a multiple of 8");
+_Static_assert(EG_NRF24L01_FRAG_MAX_MSG_LEN <= UINT16_MAX, "EG_NRF24L01_FRAG_MAX_FRAGMENTS too big");
+
+/** Control payload flag - SACK from receiver, SACK poll from sender */
+#define FRAG_FLAG_CTRL 0x80u
+/** Last fragment flag, in SACK - message complete flag */
+#define FRAG_FLAG_LAST 0x40u
+/** Message id bits of the first payload byte */
+#define FRAG_ID_MASK 0x3Fu
+/** Receiver has no completed message */
+#define FRAG_ID_NONE 0xFFu
+/** SACK payload length - flags with message id, session, first missing fragment, bitmap of following fragments */
+#define FRAG_SACK_LEN 8u
+/** SACK poll payload length - flags with message id, session */
+#define FRAG_POLL_LEN 2u
+
+static uint16_t frag_tx_pick(eg_nrf24l01_frag_tx_s *tx);
+static eg_nrf_error_e frag_tx_send(eg_nrf24l01_frag_tx_s *tx, uint16_t seq);
+static void frag_tx_acked(eg_nrf24l01_frag_tx_s *tx, uint16_t seq);
+static void frag_tx_stop_and_wait(eg_nrf24l01_frag_tx_s *tx);
+static uint8_t frag_rx_received(eg_nrf24l01_frag_rx_s *rx, uint16_t seq);
+static void frag_rx_sack(eg_nrf24l01_frag_rx_s *rx, uint8_t msg_id, uint8_t session);
+
+eg_nrf_error_e eg_nrf24l01_frag_tx_init(eg_nrf24l01_frag_tx_s *tx, eg_nrf24l01_state_s *radio, uint8_t session)
+{
+    if (NULL == tx || NULL == radio)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    memset(tx, 0, sizeof(*tx));
+    tx->radio = radio;
+    tx->session = session;
+    tx->sack = radio->config_registers.feature.en_ack_pay;
+
+    return NRF_OK;
+}
+
+eg_nrf_error_e eg_nrf24l01_frag_tx_start(eg_nrf24l01_frag_tx_s *tx, const uint8_t *data, uint16_t len)
+{
+    if (NULL == tx || NULL == tx->radio || NULL == data || 0u == len || len > EG_NRF24L01_FRAG_MAX_MSG_LEN)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+    if (1u == tx->busy)
+    {
+        return NRF_BUSY;
+    }
+
+    tx->data = data;
+    tx->len = len;
+    tx->frag_cnt = (uint16_t)((len + EG_NRF24L01_FRAG_DATA_LEN - 1u) / EG_NRF24L01_FRAG_DATA_LEN);
+    tx->base = 0u;
+    tx->next = 0u;
+    tx->acked = 0u;
+    tx->acked_serial = tx->serial_cnt;
+    tx->progress_us = eg_nrf24l01_user_time_us_get();
+    tx->poll_us = tx->progress_us;
+    tx->msg_id = (tx->msg_id + 1u) & FRAG_ID_MASK;
+    tx->in_flight = 0u;
+    tx->busy = 1u;
+
+    return NRF_OK;
+}
+
+void eg_nrf24l01_frag_tx_process(eg_nrf24l01_frag_tx_s *tx)
+{
+    uint32_t now;
+    uint16_t seq;
+
+    if (NULL == tx || 0u == tx->busy)
+    {
+        return;
+    }
+
+    if (0u == tx->sack)
+    {
+        frag_tx_stop_and_wait(tx);
+        return;
+    }
+
+    now = eg_nrf24l01_user_time_us_get();
+    if (now - tx->progress_us > EG_NRF24L01_FRAG_RTO_US)
+    {
+        /* Tail of the window lost or SACKs lost - send everything unacknowledged again */
+        for (seq = tx->base; seq < tx->next; seq++)
+        {
+            tx->serial[seq % EG_NRF24L01_FRAG_WINDOW] = 0u;
+        }
+        tx->progress_us = now;
+    }
+
+    /* Keep driver TX queue and module TX FIFO full */
+    seq = frag_tx_pick(tx);
+    while (seq < tx->frag_cnt && NRF_OK == frag_tx_send(tx, seq))
+    {
+        seq = frag_tx_pick(tx);
+    }
+
+    if (seq >= tx->frag_cnt && tx->radio->tx_queue_head == tx->radio->tx_queue_tail &&
+        0u == tx->radio->tx_fifo_level && now - tx->poll_us >= EG_NRF24L01_FRAG_POLL_US)
+    {
+        /* Everything sent - SACK arrives only in ACK of a payload */
+        uint8_t poll[FRAG_POLL_LEN] = {FRAG_FLAG_CTRL | tx->msg_id, tx->session};
+        if (NRF_OK == eg_nrf24l01_send(tx->radio, poll, FRAG_POLL_LEN))
+        {
+            tx->poll_us = now;
+        }
+    }
+}
+
+eg_nrf_error_e eg_nrf24l01_frag_tx_input(eg_nrf24l01_frag_tx_s *tx, const uint8_t *data, uint8_t len)
+{
+    uint16_t base;
+    uint32_t bitmap;
+
+    if (NULL == tx || NULL == data || FRAG_SACK_LEN != len || 0u == (data[0u] & FRAG_FLAG_CTRL))
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+    if (0u == tx->busy || 0u == tx->sack || (data[0u] & FRAG_ID_MASK) != tx->msg_id || data[1u] != tx->session)
+    {
+        /* SACK of previous message or previous sender session */
+        return NRF_OK;
+    }
+
+    if (0u != (data[0u] & FRAG_FLAG_LAST))
+    {
+        tx->busy = 0u;
+        return NRF_OK;
+    }
+
+    base = (uint16_t)(data[2u] | ((uint16_t)data[3u] << 8u));
+    bitmap = (uint32_t)data[4u] | ((uint32_t)data[5u] << 8u) | ((uint32_t)data[6u] << 16u) | ((uint32_t)data[7u] << 24u);
+    if (base < tx->base || base > tx->next)
+    {
+        /* Older SACK waited in receiver TX FIFO */
+        return NRF_OK;
+    }
+
+    if (base > tx->base || 0u != (bitmap & ~tx->acked))
+    {
+        tx->progress_us = eg_nrf24l01_user_time_us_get();
+    }
+
+    while (tx->base < base)
+    {
+        frag_tx_acked(tx, tx->base);
+        tx->base++;
+        tx->acked >>= 1u;
+    }
+    for (uint8_t i = 0u; i < EG_NRF24L01_FRAG_WINDOW && base + i < tx->next; i++)
+    {
+        if (0u != (bitmap & (1uL << i)) && 0u == (tx->acked & (1uL << i)))
+        {
+            tx->acked |= (1uL << i);
+            frag_tx_acked(tx, base + i);
+        }
+    }
+
+    if (tx->base >= tx->frag_cnt)
+    {
+        tx->busy = 0u;
+    }
+
+    return NRF_OK;
+}
+
+eg_nrf_error_e eg_nrf24l01_frag_tx_status(eg_nrf24l01_frag_tx_s *tx)
+{
+    if (NULL == tx)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    return (1u == tx->busy) ? NRF_BUSY : NRF_OK;
+}
+
+eg_nrf_error_e eg_nrf24l01_frag_rx_init(eg_nrf24l01_frag_rx_s *rx, eg_nrf24l01_state_s *radio, uint8_t pipe)
+{
+    if (NULL == rx || NULL == radio || pipe >= EG_NRF24L01_MAX_ADDRESS_NO)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    memset(rx, 0, sizeof(*rx));
+    rx->radio = radio;
+    rx->pipe = pipe;
+    rx->done_id = FRAG_ID_NONE;
+
+    return NRF_OK;
+}
+
+eg_nrf_error_e eg_nrf24l01_frag_rx_start(eg_nrf24l01_frag_rx_s *rx, uint8_t *buf, uint16_t size)
+{
+    if (NULL == rx || NULL == buf || 0u == size)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    rx->buf = buf;
+    rx->size = size;
+    rx->started = 0u;
+    rx->complete = 0u;
+    rx->armed = 1u;
+
+    return NRF_OK;
+}
+
+eg_nrf_error_e eg_nrf24l01_frag_rx_input(eg_nrf24l01_frag_rx_s *rx, const uint8_t *data, uint8_t len)
+{
+    uint8_t msg_id;
+    uint8_t session;
+    uint16_t seq;
+    uint16_t offset;
+    uint8_t data_len;
+
+    if (NULL == rx || NULL == data || len < FRAG_POLL_LEN)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    msg_id = data[0u] & FRAG_ID_MASK;
+    session = data[1u];
+    if (0u != (data[0u] & FRAG_FLAG_CTRL))
+    {
+        if (FRAG_POLL_LEN != len)
+        {
+            return NRF_INVALID_ARGUMENT;
+        }
+        frag_rx_sack(rx, msg_id, session);
+        return NRF_OK;
+    }
+    if (len <= EG_NRF24L01_FRAG_HEADER_LEN)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    seq = (uint16_t)(data[2u] | ((uint16_t)data[3u] << 8u));
+    data_len = len - EG_NRF24L01_FRAG_HEADER_LEN;
+    offset = (uint16_t)(seq * EG_NRF24L01_FRAG_DATA_LEN);
+    if (seq >= EG_NRF24L01_FRAG_MAX_FRAGMENTS ||
+        (0u == (data[0u] & FRAG_FLAG_LAST) && EG_NRF24L01_FRAG_DATA_LEN != data_len))
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    if ((msg_id != rx->done_id || session != rx->done_session) && 1u == rx->armed)
+    {
+        if (0u == rx->started || msg_id != rx->msg_id || session != rx->session)
+        {
+            /* First fragment of a new message - sender gave up the previous one if it was not complete */
+            memset(rx->received, 0, sizeof(rx->received));
+            rx->msg_id = msg_id;
+            rx->session = session;
+            rx->base = 0u;
+            rx->frag_cnt = 0u;
+            rx->started = 1u;
+        }
+
+        if ((uint32_t)offset + data_len > rx->size)
+        {
+            /* Message does not fit - fragment is not acknowledged */
+            return NRF_INVALID_ARGUMENT;
+        }
+        if (0u != (data[0u] & FRAG_FLAG_LAST))
+        {
+            rx->frag_cnt = seq + 1u;
+            rx->len = offset + data_len;
+        }
+        if (0u == frag_rx_received(rx, seq))
+        {
+            memcpy(&rx->buf[offset], &data[EG_NRF24L01_FRAG_HEADER_LEN], data_len);
+            rx->received[seq / 8u] |= (uint8_t)(1u << (seq % 8u));
+        }
+        while (rx->base < EG_NRF24L01_FRAG_MAX_FRAGMENTS && 1u == frag_rx_received(rx, rx->base))
+        {
+            rx->base++;
+        }
+        if (0u != rx->frag_cnt && rx->base >= rx->frag_cnt)
+        {
+            rx->complete = 1u;
+            rx->armed = 0u;
+            rx->done_id = msg_id;
+            rx->done_session = session;
+        }
+    }
+
+    frag_rx_sack(rx, msg_id, session);
+
+    return NRF_OK;
+}
+
+eg_nrf_error_e eg_nrf24l01_frag_rx_get(eg_nrf24l01_frag_rx_s *rx, uint16_t *len)
+{
+    if (NULL == rx || NULL == len)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+    if (0u == rx->complete)
+    {
+        return NRF_BUSY;
+    }
+
+    *len = rx->len;
+
+    return NRF_OK;
+}
+
+static uint16_t frag_tx_pick(eg_nrf24l01_frag_tx_s *tx)
+{
+    /* Fragments sent before an acknowledged one were lost - FIFO keeps the order */
+    for (uint16_t seq = tx->base; seq < tx->next; seq++)
+    {
+        uint32_t serial = tx->serial[seq % EG_NRF24L01_FRAG_WINDOW];
+        if (0u == (tx->acked & (1uL << (seq - tx->base))) && (0u == serial || serial < tx->acked_serial))
+        {
+            return seq;
+        }
+    }
+
+    if (tx->next < tx->frag_cnt && tx->next < tx->base + EG_NRF24L01_FRAG_WINDOW)
+    {
+        return tx->next;
+    }
+
+    return tx->frag_cnt;
+}
+
+static eg_nrf_error_e frag_tx_send(eg_nrf24l01_frag_tx_s *tx, uint16_t seq)
+{
+    uint8_t payload[EG_NRF24L01_MAX_PAYLOAD_LEN];
+    uint16_t offset = (uint16_t)(seq * EG_NRF24L01_FRAG_DATA_LEN);
+    uint16_t left = tx->len - offset;
+    uint8_t data_len = (left > EG_NRF24L01_FRAG_DATA_LEN) ? EG_NRF24L01_FRAG_DATA_LEN : (uint8_t)left;
+    eg_nrf_error_e err;
+
+    payload[0u] = tx->msg_id | ((seq + 1u == tx->frag_cnt) ? FRAG_FLAG_LAST : 0u);
+    payload[1u] = tx->session;
+    payload[2u] = (uint8_t)seq;
+    payload[3u] = (uint8_t)(seq >> 8u);
+    memcpy(&payload[EG_NRF24L01_FRAG_HEADER_LEN], &tx->data[offset], data_len);
+
+    err = eg_nrf24l01_send(tx->radio, payload, EG_NRF24L01_FRAG_HEADER_LEN + data_len);
+    if (NRF_OK == err)
+    {
+        if (seq == tx->next)
+        {
+            tx->next++;
+        }
+        else
+        {
+            tx->retransmits++;
+        }
+        tx->serial[seq % EG_NRF24L01_FRAG_WINDOW] = ++tx->serial_cnt;
+    }
+
+    return err;
+}
+
+static void frag_tx_acked(eg_nrf24l01_frag_tx_s *tx, uint16_t seq)
+{
+    uint32_t serial = tx->serial[seq % EG_NRF24L01_FRAG_WINDOW];
+
+    if (serial > tx->acked_serial)
+    {
+        tx->acked_serial = serial;
+    }
+}
+
+static void frag_tx_stop_and_wait(eg_nrf24l01_frag_tx_s *tx)
+{
+    if (1u == tx->in_flight)
+    {
+        /* TX_DS is the receiver radio ACK - it does not tell if receiver layer kept the fragment */
+        if (tx->radio->tx_ds_cnt != tx->tx_ds_cnt)
+        {
+            tx->in_flight = 0u;
+            tx->base++;
+            if (tx->base >= tx->frag_cnt)
+            {
+                tx->busy = 0u;
+                return;
+            }
+        }
+        else if (tx->radio->tx_max_rt_cnt != tx->tx_max_rt_cnt)
+        {
+            /* Fragment dropped after maximum retransmissions - send it again */
+            tx->in_flight = 0u;
+        }
+        else
+        {
+            return;
+        }
+    }
+
+    tx->tx_ds_cnt = tx->radio->tx_ds_cnt;
+    tx->tx_max_rt_cnt = tx->radio->tx_max_rt_cnt;
+    if (NRF_OK == frag_tx_send(tx, tx->base))
+    {
+        tx->in_flight = 1u;
+    }
+}
+
+static uint8_t frag_rx_received(eg_nrf24l01_frag_rx_s *rx, uint16_t seq)
+{
+    return (rx->received[seq / 8u] >> (seq % 8u)) & 0x01u;
+}
+
+static void frag_rx_sack(eg_nrf24l01_frag_rx_s *rx, uint8_t msg_id, uint8_t session)
+{
+    uint8_t sack[FRAG_SACK_LEN] = {FRAG_FLAG_CTRL | msg_id, session};
+    uint32_t bitmap = 0u;
+
+    if (0u == rx->radio->config_registers.feature.en_ack_pay ||
+        rx->radio->tx_queue_head != rx->radio->tx_queue_tail || 0u != rx->radio->tx_fifo_level)
+    {
+        /* Previous SACK not sent yet - one is enough, it is attached to the next ACK */
+        return;
+    }
+
+    if (msg_id == rx->done_id && session == rx->done_session)
+    {
+        sack[0u] |= FRAG_FLAG_LAST;
+    }
+    else if (1u == rx->started && msg_id == rx->msg_id && session == rx->session)
+    {
+        for (uint8_t i = 0u; i < 32u && rx->base + i < EG_NRF24L01_FRAG_MAX_FRAGMENTS; i++)
+        {
+            bitmap |= (uint32_t)frag_rx_received(rx, rx->base + i) << i;
+        }
+        sack[2u] = (uint8_t)rx->base;
+        sack[3u] = (uint8_t)(rx->base >> 8u);
+    }
+    sack[4u] = (uint8_t)bitmap;
+    sack[5u] = (uint8_t)(bitmap >> 8u);
+    sack[6u] = (uint8_t)(bitmap >> 16u);
+    sack[7u] = (uint8_t)(bitmap >> 24u);
+
+    eg_nrf24l01_ack_payload_set(rx->radio, rx->pipe, sack, FRAG_SACK_LEN);
+}
+
+/**
+ * @}
+ *
+ */
@@ -0,0 +1,190 @@
+#ifndef _EG_NRF24L01_FRAG_H_
+#define _EG_NRF24L01_FRAG_H_
+#include "stdint.h"
+#include "eg_nrf24l01.h"
+
+/**
+ * @addtogroup NRF24L01_frag NRF24L01 fragmentation layer
+ * @{
+ * @brief Messages larger than one payload are sent as numbered fragments and reassembled
+ * in caller buffer in any order. With ACK payloads enabled receiver returns selective
+ * acknowledges (SACK) in them and sender keeps a window of fragments in flight,
+ * otherwise every fragment waits for its TX_DS (stop-and-wait).
+ * Stop-and-wait TX_DS only proves the receiver radio acknowledged the payload - fragments
+ * dropped by receiver layer (no buffer armed, message too long) are still counted as sent,
+ * so receiver has to be armed with a large enough buffer before the message starts.
+ * Messages are identified by message id and sender session, so a restarted sender
+ * is not taken for the sender of the last completed message.
+ * Fragment payloads need dynamic payload length on receiver pipe.
+ */
+
+#ifndef EG_NRF24L01_FRAG_MAX_FRAGMENTS
+/** Maximum number of fragments of one message */
+#define EG_NRF24L01_FRAG_MAX_FRAGMENTS 256u
+#endif
+
+#ifndef EG_NRF24L01_FRAG_WINDOW
+/** Number of fragments sent ahead of the first unacknowledged one (1 - 32) */
+#define EG_NRF24L01_FRAG_WINDOW 32u
+#endif
+
+#ifndef EG_NRF24L01_FRAG_RTO_US
+/** Time without SACK progress after which unacknowledged fragments are sent again */
+#define EG_NRF24L01_FRAG_RTO_US 20000u
+#endif
+
+#ifndef EG_NRF24L01_FRAG_POLL_US
+/** Interval of empty payloads pulling SACK from receiver when all fragments are sent */
+#define EG_NRF24L01_FRAG_POLL_US 1000u
+#endif
+
+/** Fragment header length - flags with message id, sender session and 16 bit fragment number */
+#define EG_NRF24L01_FRAG_HEADER_LEN 4u
+/** Message bytes in one fragment */
+#define EG_NRF24L01_FRAG_DATA_LEN (EG_NRF24L01_MAX_PAYLOAD_LEN - EG_NRF24L01_FRAG_HEADER_LEN)
+/** Maximum message length */
+#define EG_NRF24L01_FRAG_MAX_MSG_LEN (EG_NRF24L01_FRAG_MAX_FRAGMENTS * EG_NRF24L01_FRAG_DATA_LEN)
+
+/** Message sender state */
+typedef struct
+{
+    eg_nrf24l01_state_s *radio;                 /**< Driver instance */
+    const uint8_t *data;                        /**< Message data - caller buffer */
+    uint16_t len;                               /**< Message length */
+    uint16_t frag_cnt;                          /**< Number of fragments */
+    uint16_t base;                              /**< First unacknowledged fragment */
+    uint16_t next;                              /**< First never sent fragment */
+    uint32_t acked;                             /**< Bit n - fragment base + n acknowledged */
+    uint32_t serial[EG_NRF24L01_FRAG_WINDOW];   /**< Send order of fragments in window, 0 - send again */
+    uint32_t serial_cnt;                        /**< Number of sent fragments */
+    uint32_t acked_serial;                      /**< Highest send order number acknowledged */
+    uint32_t progress_us;                       /**< Time of the last SACK progress */
+    uint32_t poll_us;                           /**< Time of the last SACK poll */
+    uint32_t retransmits;                       /**< Number of fragments sent again */
+    uint8_t msg_id;                             /**< Current message id */
+    uint8_t session;                            /**< Sender session - boot epoch or random nonce */
+    uint8_t sack;                               /**< SACK mode - ACK payloads enabled */
+    uint8_t in_flight;                          /**< Stop-and-wait fragment sent */
+    uint8_t tx_ds_cnt;                          /**< Driver tx_ds_cnt when stop-and-wait fragment was sent */
+    uint8_t tx_max_rt_cnt;                      /**< Driver tx_max_rt_cnt when stop-and-wait fragment was sent */
+    uint8_t busy;                               /**< Message transfer in progress */
+} eg_nrf24l01_frag_tx_s;
+
+/** Message receiver state */
+typedef struct
+{
+    eg_nrf24l01_state_s *radio;                                /**< Driver instance */
+    uint8_t *buf;                                              /**< Reassembly buffer - caller buffer */
+    uint16_t size;                                             /**< Reassembly buffer size */
+    uint16_t len;                                              /**< Message length, known with the last fragment */
+    uint16_t frag_cnt;                                         /**< Number of fragments, 0 - last fragment not received yet */
+    uint16_t base;                                             /**< First missing fragment */
+    uint8_t received[EG_NRF24L01_FRAG_MAX_FRAGMENTS / 8u];     /**< Received fragments bitmap */
+    uint8_t pipe;                                              /**< Pipe used for SACK payloads */
+    uint8_t msg_id;                                            /**< Message being received */
+    uint8_t session;                                           /**< Sender session of message being received */
+    uint8_t done_id;                                           /**< Last completed message, its fragments are only acknowledged */
+    uint8_t done_session;                                      /**< Sender session of last completed message */
+    uint8_t armed;                                             /**< Buffer given for the next message */
+    uint8_t started;                                           /**< Fragment of the message received */
+    uint8_t complete;                                          /**< Message reassembled */
+} eg_nrf24l01_frag_rx_s;
+
+/**
+ * Function to initialise message sender
+ * @brief SACK mode is used when driver has ACK payloads enabled.
+ * Message ids restart with every init, session tells receiver it is a new sender run.
+ *
+ * @param tx pointer to sender state
+ * @param radio pointer to initialised driver state object
+ * @param session sender session - boot counter or random nonce, different from the previous run
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_frag_tx_init(eg_nrf24l01_frag_tx_s *tx, eg_nrf24l01_state_s *radio, uint8_t session);
+
+/**
+ * Function to start message transfer
+ * @brief Data buffer has to stay valid until eg_nrf24l01_frag_tx_status returns NRF_OK.
+ *
+ * @param tx pointer to sender state
+ * @param data pointer to message data
+ * @param len message length (1 - EG_NRF24L01_FRAG_MAX_MSG_LEN)
+ * @return eg_nrf_error_e error code, NRF_BUSY - previous message not delivered yet
+ */
+extern eg_nrf_error_e eg_nrf24l01_frag_tx_start(eg_nrf24l01_frag_tx_s *tx, const uint8_t *data, uint16_t len);
+
+/**
+ * Function to process message sender - queues fragments while driver TX queue has space
+ * @brief Should be called next to eg_nrf24l01_process.
+ *
+ * @param tx pointer to sender state
+ */
+extern void eg_nrf24l01_frag_tx_process(eg_nrf24l01_frag_tx_s *tx);
+
+/**
+ * Function to pass payload received in ACK to message sender
+ *
+ * @param tx pointer to sender state
+ * @param data pointer to payload
+ * @param len payload length
+ * @return eg_nrf_error_e error code, NRF_INVALID_ARGUMENT - not a SACK payload
+ */
+extern eg_nrf_error_e eg_nrf24l01_frag_tx_input(eg_nrf24l01_frag_tx_s *tx, const uint8_t *data, uint8_t len);
+
+/**
+ * Function to check message transfer state
+ * @brief In SACK mode NRF_OK means receiver reassembled the message, in stop-and-wait mode
+ * only that receiver radio acknowledged every fragment.
+ *
+ * @param tx pointer to sender state
+ * @return eg_nrf_error_e NRF_OK - message delivered, NRF_BUSY - transfer in progress
+ */
+extern eg_nrf_error_e eg_nrf24l01_frag_tx_status(eg_nrf24l01_frag_tx_s *tx);
+
+/**
+ * Function to initialise message receiver
+ *
+ * @param rx pointer to receiver state
+ * @param radio pointer to initialised driver state object
+ * @param pipe pipe fragments are received on - SACK payloads are attached to its ACKs
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_frag_rx_init(eg_nrf24l01_frag_rx_s *rx, eg_nrf24l01_state_s *radio, uint8_t pipe);
+
+/**
+ * Function to give reassembly buffer for the next message
+ *
+ * @param rx pointer to receiver state
+ * @param buf pointer to reassembly buffer
+ * @param size buffer size - fragments of longer messages are not acknowledged in SACK mode,
+ * in stop-and-wait mode they are dropped
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_frag_rx_start(eg_nrf24l01_frag_rx_s *rx, uint8_t *buf, uint16_t size);
+
+/**
+ * Function to pass received payload to message receiver
+ * @brief Has to be called from the context driver TX functions are called from, it may queue SACK payload.
+ *
+ * @param rx pointer to receiver state
+ * @param data pointer to payload
+ * @param len payload length
+ * @return eg_nrf_error_e error code, NRF_INVALID_ARGUMENT - not a fragment payload
+ */
+extern eg_nrf_error_e eg_nrf24l01_frag_rx_input(eg_nrf24l01_frag_rx_s *rx, const uint8_t *data, uint8_t len);
+
+/**
+ * Function to get reassembled message
+ *
+ * @param rx pointer to receiver state
+ * @param len pointer to message length output
+ * @return eg_nrf_error_e NRF_OK - message complete in buffer, NRF_BUSY - fragments missing
+ */
+extern eg_nrf_error_e eg_nrf24l01_frag_rx_get(eg_nrf24l01_frag_rx_s *rx, uint16_t *len);
+
+/**
+ * @}
+ *
+ */
+
+#endif /* _EG_NRF24L01_FRAG_H_ */
@@ -0,0 +1,231 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "eg_nrf24l01_hop.h"
+
+/**
+ * @addtogroup NRF24L01_hop
+ * @{
+ *
+ */
+
+/** Seed used instead of 0 - xorshift generator never leaves state 0 */
+#define HOP_SEED_DEFAULT 0x2545F491u
+
+static uint32_t hop_random(uint32_t *seed);
+static void hop_slot_next(eg_nrf24l01_hop_s *hop);
+static void hop_rx_sync(eg_nrf24l01_hop_s *hop);
+
+eg_nrf_error_e eg_nrf24l01_hop_init(eg_nrf24l01_hop_s *hop, eg_nrf24l01_state_s *radio,
+                                    const eg_nrf24l01_hop_init_data_s *init_data)
+{
+    uint32_t seed;
+
+    if (NULL == hop || NULL == radio || NULL == init_data || NULL == init_data->channels ||
+        init_data->channel_cnt < 2u || init_data->channel_cnt > EG_NRF24L01_HOP_MAX_CHANNELS ||
+        init_data->role > HOP_ROLE_SLAVE || init_data->guard_us >= init_data->slot_us ||
+        init_data->sync_offset_us >= init_data->slot_us)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    for (uint8_t i = 0u; i < init_data->channel_cnt; i++)
+    {
+        if (init_data->channels[i] >= EG_NRF24L01_CHANNEL_CNT)
+        {
+            return NRF_INVALID_ARGUMENT;
+        }
+        hop->sequence[i] = init_data->channels[i];
+        hop->score[i] = 0u;
+    }
+
+    /* Fisher-Yates shuffle - same seed gives the same sequence on all nodes */
+    seed = (0u == init_data->seed) ? HOP_SEED_DEFAULT : init_data->seed;
+    for (uint8_t i = init_data->channel_cnt - 1u; i > 0u; i--)
+    {
+        uint8_t j = (uint8_t)(hop_random(&seed) % (i + 1u));
+        uint8_t channel = hop->sequence[i];
+        hop->sequence[i] = hop->sequence[j];
+        hop->sequence[j] = channel;
+    }
+
+    hop->radio = radio;
+    hop->channel_cnt = init_data->channel_cnt;
+    hop->role = init_data->role;
+    hop->slot_us = init_data->slot_us;
+    hop->guard_us = init_data->guard_us;
+    hop->sync_offset_us = init_data->sync_offset_us;
+    hop->slot_start_us = eg_nrf24l01_user_time_us_get();
+    hop->pos = 0u;
+    hop->synced = (HOP_ROLE_MASTER == hop->role);
+    hop->slot_rx = 0u;
+    hop->idle_slots = 0u;
+    hop->rx_cnt = radio->rx_cnt;
+    hop->tx_ds_cnt = radio->tx_ds_cnt;
+    hop->tx_max_rt_cnt = radio->tx_max_rt_cnt;
+    hop->guard = 0u;
+
+    /* Only RF_CH register is written on every hop */
+    eg_nrf24l01_channel_set(radio, hop->sequence[0u]);
+    if (HOP_ROLE_MASTER == hop->role)
+    {
+        eg_nrf24l01_tx_pause(radio, 0u);
+    }
+
+    return NRF_OK;
+}
+
+void eg_nrf24l01_hop_process(eg_nrf24l01_hop_s *hop)
+{
+    int32_t in_slot;
+
+    if (NULL == hop || NULL == hop->radio)
+    {
+        return;
+    }
+
+    if (HOP_ROLE_SLAVE == hop->role && hop->rx_cnt != hop->radio->rx_cnt)
+    {
+        hop_rx_sync(hop);
+    }
+
+    in_slot = (int32_t)(eg_nrf24l01_user_time_us_get() - hop->slot_start_us);
+    while (in_slot >= (int32_t)hop->slot_us)
+    {
+        hop_slot_next(hop);
+        in_slot -= (int32_t)hop->slot_us;
+    }
+
+    if (HOP_ROLE_MASTER == hop->role && 0u == hop->guard &&
+        in_slot >= (int32_t)(hop->slot_us - hop->guard_us))
+    {
+        /* Let module TX FIFO drain before the channel changes */
+        eg_nrf24l01_tx_pause(hop->radio, 1u);
+        hop->guard = 1u;
+    }
+}
+
+uint8_t eg_nrf24l01_hop_synced(eg_nrf24l01_hop_s *hop)
+{
+    if (NULL == hop)
+    {
+        return 0u;
+    }
+
+    return hop->synced;
+}
+
+static uint32_t hop_random(uint32_t *seed)
+{
+    uint32_t x = *seed;
+
+    x ^= x << 13u;
+    x ^= x >> 17u;
+    x ^= x << 5u;
+    *seed = x;
+
+    return x;
+}
+
+static void hop_slot_next(eg_nrf24l01_hop_s *hop)
+{
+    eg_nrf24l01_state_s *radio = hop->radio;
+
+    hop->slot_start_us += hop->slot_us;
+
+    if (HOP_ROLE_MASTER == hop->role)
+    {
+        uint8_t delivered = (uint8_t)(radio->tx_ds_cnt - hop->tx_ds_cnt);
+        uint8_t failed = (uint8_t)(radio->tx_max_rt_cnt - hop->tx_max_rt_cnt);
+
+        hop->tx_ds_cnt += delivered;
+        hop->tx_max_rt_cnt += failed;
+
+        /* Penalise channel that lost everything, forget old failures slowly - skipped channel
+         * is retried once its score decays below the limit */
+        if (0u != failed && 0u == delivered)
+        {
+            hop->score[hop->pos] = (hop->score[hop->pos] > UINT8_MAX - EG_NRF24L01_HOP_FAIL_PENALTY)
+                                       ? UINT8_MAX
+                                       : hop->score[hop->pos] + EG_NRF24L01_HOP_FAIL_PENALTY;
+        }
+        else if (0u != hop->score[hop->pos])
+        {
+            hop->score[hop->pos]--;
+        }
+
+        hop->pos = (hop->pos + 1u) % hop->channel_cnt;
+        eg_nrf24l01_channel_set(radio, hop->sequence[hop->pos]);
+
+        /* Slot timing is kept on bad channels, payloads wait for the next good one */
+        hop->guard = 0u;
+        eg_nrf24l01_tx_pause(radio, (hop->score[hop->pos] >= EG_NRF24L01_HOP_BAD_SCORE));
+        return;
+    }
+
+    if (0u == hop->slot_rx && hop->idle_slots < UINT16_MAX)
+    {
+        hop->idle_slots++;
+    }
+    hop->slot_rx = 0u;
+
+    if (1u == hop->synced)
+    {
+        if (hop->idle_slots >= (uint16_t)(EG_NRF24L01_HOP_LOST_ROUNDS * hop->channel_cnt))
+        {
+            /* Master lost - stay on current channel and wait for it */
+            hop->synced = 0u;
+            hop->idle_slots = 0u;
+            return;
+        }
+        hop->pos = (hop->pos + 1u) % hop->channel_cnt;
+        eg_nrf24l01_channel_set(radio, hop->sequence[hop->pos]);
+    }
+    else if (hop->idle_slots > hop->channel_cnt)
+    {
+        /* Master visits every channel once per round - change the channel in case it is jammed */
+        hop->idle_slots = 0u;
+        hop->pos = (hop->pos + 1u) % hop->channel_cnt;
+        eg_nrf24l01_channel_set(radio, hop->sequence[hop->pos]);
+    }
+}
+
+static void hop_rx_sync(eg_nrf24l01_hop_s *hop)
+{
+    uint32_t time_us = hop->radio->rx_time_us;
+    int32_t error;
+
+    hop->rx_cnt = hop->radio->rx_cnt;
+    hop->idle_slots = 0u;
+
+    if (0u == hop->synced)
+    {
+        /* Payload received on parked channel - its slot is the current sequence position */
+        hop->synced = 1u;
+        hop->slot_rx = 1u;
+        hop->slot_start_us = time_us - hop->sync_offset_us;
+        return;
+    }
+
+    error = (int32_t)(time_us - hop->slot_start_us);
+    if (1u == hop->slot_rx || error < 0)
+    {
+        /* Only the first payload of a slot received after the channel switch carries timing */
+        hop->slot_rx = 1u;
+        return;
+    }
+    hop->slot_rx = 1u;
+
+    error -= (int32_t)hop->sync_offset_us;
+    if (error > (int32_t)EG_NRF24L01_HOP_DRIFT_US)
+    {
+        /* Later payload may be a retransmission - move slot start later only slowly */
+        error = (int32_t)EG_NRF24L01_HOP_DRIFT_US;
+    }
+    hop->slot_start_us += (uint32_t)error;
+}
+
+/**
+ * @}
+ *
+ */
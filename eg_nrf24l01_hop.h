@@ -0,0 +1,114 @@
+#ifndef _EG_NRF24L01_HOP_H_
+#define _EG_NRF24L01_HOP_H_
+#include "stdint.h"
+#include "eg_nrf24l01.h"
+
+/**
+ * @addtogroup NRF24L01_hop NRF24L01 channel hopping layer
+ * @{
+ * @brief Time slotted hopping over a pseudo-random channel sequence. Master (PTX) sends
+ * only inside its slots, slaves (PRX) follow it and resynchronise on received payloads.
+ * Both sides need the same channel set and seed.
+ */
+
+#ifndef EG_NRF24L01_HOP_MAX_CHANNELS
+/** Maximum number of channels in the hop sequence */
+#define EG_NRF24L01_HOP_MAX_CHANNELS 16u
+#endif
+
+#ifndef EG_NRF24L01_HOP_BAD_SCORE
+/** Channel score at which master stops transmitting in the channel slot */
+#define EG_NRF24L01_HOP_BAD_SCORE 8u
+#endif
+
+#ifndef EG_NRF24L01_HOP_FAIL_PENALTY
+/** Score added to a channel when its slot ended with MAX_RT and no delivered payload */
+#define EG_NRF24L01_HOP_FAIL_PENALTY 4u
+#endif
+
+#ifndef EG_NRF24L01_HOP_LOST_ROUNDS
+/** Number of whole sequence rounds without payload after which slave drops synchronisation */
+#define EG_NRF24L01_HOP_LOST_ROUNDS 2u
+#endif
+
+#ifndef EG_NRF24L01_HOP_DRIFT_US
+/** Maximum shift of slave slot start towards later time per received slot in us */
+#define EG_NRF24L01_HOP_DRIFT_US 20u
+#endif
+
+/** Hopping role */
+typedef enum
+{
+    HOP_ROLE_MASTER = 0, /**< Owns slot timing, transmits payloads */
+    HOP_ROLE_SLAVE = 1   /**< Follows master timing from received payloads */
+} eg_nrf_hop_role_e;
+
+/** Hopping layer initialization structure */
+typedef struct
+{
+    const uint8_t *channels; /**< Channel set */
+    uint8_t channel_cnt;     /**< Number of channels in the set (2 - EG_NRF24L01_HOP_MAX_CHANNELS) */
+    uint32_t seed;           /**< Hop sequence seed */
+    uint32_t slot_us;        /**< Slot length in us */
+    uint32_t guard_us;       /**< Time at slot end in which master does not transmit - longer than one retransmission cycle */
+    uint32_t sync_offset_us; /**< Time from slot start to IRQ of the first payload at slave in us */
+    eg_nrf_hop_role_e role;  /**< Hopping role */
+} eg_nrf24l01_hop_init_data_s;
+
+/** Hopping layer state */
+typedef struct
+{
+    eg_nrf24l01_state_s *radio;                          /**< Driver instance */
+    uint8_t sequence[EG_NRF24L01_HOP_MAX_CHANNELS];      /**< Hop sequence */
+    uint8_t score[EG_NRF24L01_HOP_MAX_CHANNELS];         /**< Channel failure score per sequence position - master only */
+    uint8_t channel_cnt;                                 /**< Number of channels in the sequence */
+    eg_nrf_hop_role_e role;                              /**< Hopping role */
+    uint32_t slot_us;                                    /**< Slot length in us */
+    uint32_t guard_us;                                   /**< Slot end guard time in us */
+    uint32_t sync_offset_us;                             /**< Expected first payload time in slot in us */
+    uint32_t slot_start_us;                              /**< Start time of current slot */
+    uint8_t pos;                                         /**< Current sequence position */
+    uint8_t synced;                                      /**< Slave follows master timing */
+    uint8_t slot_rx;                                     /**< Payload received in current slot */
+    uint16_t idle_slots;                                 /**< Slots without payload in a row */
+    uint16_t rx_cnt;                                     /**< Driver rx_cnt seen last time */
+    uint8_t tx_ds_cnt;                                   /**< Driver tx_ds_cnt at slot start */
+    uint8_t tx_max_rt_cnt;                               /**< Driver tx_max_rt_cnt at slot start */
+    uint8_t guard;                                       /**< Master TX paused for slot end */
+} eg_nrf24l01_hop_s;
+
+/**
+ * Function to initialise hopping layer
+ * @brief Driver instance has to be initialised. Master starts its first slot immediately,
+ * slave listens on the first sequence channel until a payload arrives.
+ *
+ * @param hop pointer to hopping layer state
+ * @param radio pointer to initialised driver state object
+ * @param init_data pointer to initialisation data
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_hop_init(eg_nrf24l01_hop_s *hop, eg_nrf24l01_state_s *radio,
+                                           const eg_nrf24l01_hop_init_data_s *init_data);
+
+/**
+ * Function to process hopping layer
+ * @brief Should be called next to eg_nrf24l01_process, at least a few times per guard time.
+ *
+ * @param hop pointer to hopping layer state
+ */
+extern void eg_nrf24l01_hop_process(eg_nrf24l01_hop_s *hop);
+
+/**
+ * Function to check if slave follows master slots
+ *
+ * @param hop pointer to hopping layer state
+ * @return uint8_t 1 - synchronised (always 1 for master), 0 - searching
+ */
+extern uint8_t eg_nrf24l01_hop_synced(eg_nrf24l01_hop_s *hop);
+
+/**
+ * @}
+ *
+ */
+
+#endif /* _EG_NRF24L01_HOP_H_ */
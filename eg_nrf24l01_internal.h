@@ -9,13 +9,203 @@
  */
 /** Maximum address length in bytes */
 #define EG_NRF24L01_ADDRESS_MAX_WIDTH 5u
+/** Maximum address index */
+#define EG_NRF24L01_MAX_ADDRESS_NO 6u
+/** Maximum payload length in bytes */
+#define EG_NRF24L01_MAX_PAYLOAD_LEN 32u
+/** nRF24L01 TX FIFO depth */
+#define EG_NRF24L01_TX_FIFO_DEPTH 3u
+/** Number of nRF24L01 RF channels */
+#define EG_NRF24L01_CHANNEL_CNT 126u
+
+#ifndef EG_NRF24L01_POR_DELAY_US
+/** Power on reset time (Tpor) waited before the first SPI access after eg_nrf24l01_power_on,
+ * may be set to 0 when module supply is stable long before (e.g. MCU reset only) */
+#define EG_NRF24L01_POR_DELAY_US 100000u
+#endif
+
+#ifndef EG_NRF24L01_TPD2STBY_US
+/** Power down to standby-I transition time (Tpd2stby) - 1500us with crystal oscillator,
+ * 150us with external clock */
+#define EG_NRF24L01_TPD2STBY_US 1500u
+#endif
+
+#ifndef EG_NRF24L01_SPI_TIMEOUT_US
+/** Time after which SPI transfer without eg_nrf24l01_spi_comm_complete is abandoned and module
+ * is configured again, 0 - wait forever */
+#define EG_NRF24L01_SPI_TIMEOUT_US 10000u
+#endif
+
+#ifndef EG_NRF24L01_TX_TIMEOUT_US
+/** Time without TX event while PTX FIFO holds payloads after which module is configured again
+ * (lost IRQ), has to exceed the longest retransmission sequence, 0 - wait forever */
+#define EG_NRF24L01_TX_TIMEOUT_US 100000u
+#endif
+
+#ifndef EG_NRF24L01_TX_QUEUE_SIZE
+/** Software TX queue depth in payloads - must be a power of two */
+#define EG_NRF24L01_TX_QUEUE_SIZE 4u
+#endif
+
+#ifndef EG_NRF24L01_RX_RING_SIZE
+/** RX payload ring depth - must be a power of two, 0 delivers payloads through rx_callback */
+#define EG_NRF24L01_RX_RING_SIZE 0u
+#endif
+
+/** SPI tx buffer size - command byte followed by the longest register value (address),
+ * bytes clocked past tx_len are NOP fillers supplied by the user SPI driver */
+#define EG_NRF24L01_SPI_TX_BUF_SIZE (1u + EG_NRF24L01_ADDRESS_MAX_WIDTH)
+/** SPI rx buffer size - STATUS byte followed by payload, also with RX ring as payload writes
+ * clock the same number of bytes in as out */
+#define EG_NRF24L01_SPI_RX_BUF_SIZE (1u + EG_NRF24L01_MAX_PAYLOAD_LEN)
+
+#ifndef EG_NRF24L01_CHAIN_MAX_STEPS
+/** Maximum number of state handlers executed in a row with SPI chaining enabled */
+#define EG_NRF24L01_CHAIN_MAX_STEPS 8u
+#endif
+
+#ifndef EG_NRF24L01_BUS_MAX_INSTANCES
+/** Maximum number of driver instances sharing one SPI bus */
+#define EG_NRF24L01_BUS_MAX_INSTANCES 4u
+#endif
+
+#ifndef EG_NRF24L01_ENTER_CRITICAL
+#if defined(__ARM_ARCH_6M__)
+/** Enter critical section - PRIMASK is saved and interrupts disabled, used at most once per block scope */
+#define EG_NRF24L01_ENTER_CRITICAL() \
+    uint32_t eg_nrf24l01_primask_;  \
+    __asm volatile("mrs %0, primask\n\tcpsid i" : "=r"(eg_nrf24l01_primask_) : : "memory")
+/** Exit critical section - PRIMASK is restored */
+#define EG_NRF24L01_EXIT_CRITICAL() __asm volatile("msr primask, %0" : : "r"(eg_nrf24l01_primask_) : "memory")
+#else
+/** Enter critical section - used only by the atomic operations below on targets without
+ * atomic read-modify-write instructions */
+#define EG_NRF24L01_ENTER_CRITICAL()
+/** Exit critical section */
+#define EG_NRF24L01_EXIT_CRITICAL()
+#endif
+#endif
+
+#ifndef EG_NRF24L01_ATOMIC_OR
+#if defined(__ARM_ARCH_6M__)
+/* Cortex-M0 has no exclusive access instructions and __atomic read-modify-write builtins end up
+ * as libcalls missing from bare metal runtimes - interrupts are disabled around the operation */
+/** Atomic OR evaluating to the previous value */
+#define EG_NRF24L01_ATOMIC_OR(ptr, val) __extension__({ \
+    __typeof__(*(ptr)) eg_nrf24l01_prev_;               \
+    EG_NRF24L01_ENTER_CRITICAL();                       \
+    eg_nrf24l01_prev_ = *(ptr);                         \
+    *(ptr) = eg_nrf24l01_prev_ | (val);                 \
+    EG_NRF24L01_EXIT_CRITICAL();                        \
+    eg_nrf24l01_prev_;                                  \
+})
+/** Atomic AND evaluating to the previous value */
+#define EG_NRF24L01_ATOMIC_AND(ptr, val) __extension__({ \
+    __typeof__(*(ptr)) eg_nrf24l01_prev_;                \
+    EG_NRF24L01_ENTER_CRITICAL();                        \
+    eg_nrf24l01_prev_ = *(ptr);                          \
+    *(ptr) = eg_nrf24l01_prev_ & (val);                  \
+    EG_NRF24L01_EXIT_CRITICAL();                         \
+    eg_nrf24l01_prev_;                                   \
+})
+/** Atomic compare and swap evaluating to 1 when *ptr was expected and got desired */
+#define EG_NRF24L01_ATOMIC_CAS(ptr, expected, desired) __extension__({ \
+    uint8_t eg_nrf24l01_swapped_ = 0u;                                  \
+    EG_NRF24L01_ENTER_CRITICAL();                                       \
+    if ((expected) == *(ptr))                                           \
+    {                                                                   \
+        *(ptr) = (desired);                                             \
+        eg_nrf24l01_swapped_ = 1u;                                      \
+    }                                                                   \
+    EG_NRF24L01_EXIT_CRITICAL();                                        \
+    eg_nrf24l01_swapped_;                                               \
+})
+#else
+/** Atomic OR evaluating to the previous value - define all three for targets without atomic
+ * read-modify-write instructions */
+#define EG_NRF24L01_ATOMIC_OR(ptr, val) __atomic_fetch_or((ptr), (val), __ATOMIC_ACQ_REL)
+/** Atomic AND evaluating to the previous value */
+#define EG_NRF24L01_ATOMIC_AND(ptr, val) __atomic_fetch_and((ptr), (val), __ATOMIC_ACQ_REL)
+/** Atomic compare and swap evaluating to 1 when *ptr was expected and got desired */
+#define EG_NRF24L01_ATOMIC_CAS(ptr, expected, desired) __extension__({                         \
+    __typeof__(desired) eg_nrf24l01_expected_ = (expected);                                     \
+    (uint8_t)__atomic_compare_exchange_n((ptr), &eg_nrf24l01_expected_, (desired), 0,          \
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);                  \
+})
+#endif
+#endif
+
+#ifndef EG_NRF24L01_SCAN
+/** Enable RPD spectrum scanner (0 - disabled, 1 - enabled) */
+#define EG_NRF24L01_SCAN 0
+#endif
+
+#ifndef EG_NRF24L01_RPD_DWELL_US
+/** Time in RX mode before RPD sample is latched - RPD needs 170us (Tstby2a included) */
+#define EG_NRF24L01_RPD_DWELL_US 170u
+#endif
+
+#ifndef EG_NRF24L01_STATS
+/** Enable driver statistics counters (0 - disabled, 1 - enabled) */
+#define EG_NRF24L01_STATS 0
+#endif
+
+#ifndef EG_NRF24L01_OBSERVE_TX
+/** Read OBSERVE_TX after every TX event even without statistics (0 - disabled, 1 - enabled),
+ * required by link adaptation layer */
+#define EG_NRF24L01_OBSERVE_TX 0
+#endif
+
+#ifndef EG_NRF24L01_TRACE_DEPTH
+/** SPI transaction trace ring depth in records - must be a power of two, 0 disables the trace */
+#define EG_NRF24L01_TRACE_DEPTH 0u
+#endif
+
+#ifndef EG_NRF24L01_TRACE_DATA_LEN
+/** Number of leading TX and RX bytes of each SPI transaction stored in the trace */
+#define EG_NRF24L01_TRACE_DATA_LEN 4u
+#endif
+
+#ifndef EG_NRF24L01_STATS_HIST_BUCKETS
+/** Number of log2 buckets of statistics histograms - bucket n counts values of [2^(n-1), 2^n) ticks,
+ * the last bucket counts everything above */
+#define EG_NRF24L01_STATS_HIST_BUCKETS 16u
+#endif
+
+/** Driver events signalled to event callback
+ * @brief Events come in the order the state machine handles them:
+ * - NRF_EVENT_RX follows the payload delivery to rx_callback or RX ring,
+ * - TX events of one report follow payload order in TX FIFO - every NRF_EVENT_TX_DONE
+ *   before NRF_EVENT_TX_FAILED, then nothing more for those payloads,
+ * - NRF_EVENT_RECOVERY comes after NRF_EVENT_TX_FAILED of every payload lost with module FIFO
+ *   and NRF_EVENT_SCAN_DONE of the sweep it ended,
+ *   followed by NRF_EVENT_POWER_ON once configured again (and NRF_EVENT_POWER_UP when it was awake). */
+typedef enum
+{
+    NRF_EVENT_POWER_ON = 0,   /**< Power on configuration written - module in power down */
+    NRF_EVENT_POWER_UP = 1,   /**< Wake up done - module listening or transmitting */
+    NRF_EVENT_POWER_DOWN = 2, /**< Sleep request done - module in power down */
+    NRF_EVENT_RX = 3,         /**< Payload delivered to RX callback or RX ring */
+    NRF_EVENT_TX_DONE = 4,    /**< TX_DS - payload sent (acknowledged when auto acknowledge is used), signalled once per payload */
+    NRF_EVENT_TX_FAILED = 5,  /**< MAX_RT - payload dropped, signalled once per payload - also for payloads flushed behind it or lost by recovery */
+    NRF_EVENT_SCAN_DONE = 6,  /**< Spectrum scan sweep done - also when ended early by recovery */
+    NRF_EVENT_RECOVERY = 7,   /**< SPI or TX timeout - module is configured again, payloads in its FIFOs are lost */
+} eg_nrf_event_e;
+
+struct eg_nrf24l01_state_s;
 
 /** User RX callback prototype */
 typedef void (*eg_nrf_rx_callback)(uint8_t *data, uint8_t data_size);
+/** User driver event callback prototype - with SPI chaining called from SPI completion / IRQ
+ * context, so it must not queue payloads (TX queue is single producer), eg_nrf24l01_process
+ * context should be signalled instead */
+typedef void (*eg_nrf_event_callback)(struct eg_nrf24l01_state_s *state, eg_nrf_event_e event);
 /** User set GPIO pin state prototype */
 typedef void (*eg_nrf_set_pin_state_callback)(uint8_t state);
 /** User get GPIO pin state prototype */
 typedef uint8_t (*eg_nrf_get_pin_state_callback)(void);
+/** User SPI transfer abort prototype */
+typedef void (*eg_nrf_spi_abort_callback)(struct eg_nrf24l01_state_s *state);
 
 /** nRF24L01 SETUP_AW register struct */
 typedef union
@@ -82,6 +272,55 @@ typedef union
     uint8_t val; /** RAW value */
 } eg_nrf24l01_fifo_status_reg_s;
 
+/** nRF24L01 SETUP_RETR register struct */
+typedef union
+{
+    struct
+    {
+        uint8_t arc : 4; /**< Auto retransmit count, 0 - disabled */
+        uint8_t ard : 4; /**< Auto retransmit delay, (ard + 1) * 250us */
+    } __attribute__((packed));
+    uint8_t val; /** RAW value */
+} eg_nrf24l01_setup_retr_reg_s;
+
+/** nRF24L01 RF_CH register struct */
+typedef union
+{
+    struct
+    {
+        uint8_t rf_ch : 7; /**< RF channel, 2400 + rf_ch MHz */
+        uint8_t : 1;
+    } __attribute__((packed));
+    uint8_t val; /** RAW value */
+} eg_nrf24l01_rf_ch_reg_s;
+
+/** nRF24L01 RF_SETUP register struct */
+typedef union
+{
+    struct
+    {
+        uint8_t : 1;
+        uint8_t rf_pwr : 2;     /**< TX output power */
+        uint8_t rf_dr_high : 1; /**< 2 Mbps data rate */
+        uint8_t pll_lock : 1;   /**< Force PLL lock signal, test only */
+        uint8_t rf_dr_low : 1;  /**< 250 kbps data rate */
+        uint8_t : 1;
+        uint8_t cont_wave : 1;  /**< Continuous carrier transmit, test only */
+    } __attribute__((packed));
+    uint8_t val; /** RAW value */
+} eg_nrf24l01_rf_setup_reg_s;
+
+/** nRF24L01 OBSERVE_TX register struct */
+typedef union
+{
+    struct
+    {
+        uint8_t arc_cnt : 4;  /**< Retransmitted packets count, reset when new packet transmission starts */
+        uint8_t plos_cnt : 4; /**< Lost packets count, saturates at 15, reset by writing RF_CH */
+    } __attribute__((packed));
+    uint8_t val; /** RAW value */
+} eg_nrf24l01_observe_tx_reg_s;
+
 /** nRF24L01 Enable Auto Acknowledgment register */
 typedef struct
 {
@@ -134,6 +373,38 @@ typedef struct
     };
 } __attribute__((packed)) eg_nrf24l01_rx_pw_px_reg_s;
 
+/** nRF24L01 Enable dynamic payload length register */
+typedef struct
+{
+    union
+    {
+        struct
+        {
+            uint8_t p0 : 1; /**< PIPE 0 */
+            uint8_t p1 : 1; /**< PIPE 1 */
+            uint8_t p2 : 1; /**< PIPE 2 */
+            uint8_t p3 : 1; /**< PIPE 3 */
+            uint8_t p4 : 1; /**< PIPE 4 */
+            uint8_t p5 : 1; /**< PIPE 5 */
+            uint8_t : 2;
+        } __attribute__((packed));
+        uint8_t val; /** RAW value */
+    };
+} __attribute__((packed)) eg_nrf24l01_dynpd_reg_s;
+
+/** nRF24L01 Feature register */
+typedef union
+{
+    struct
+    {
+        uint8_t en_dyn_ack : 1; /**< Enables the W_TX_PAYLOAD_NOACK command */
+        uint8_t en_ack_pay : 1; /**< Enables payload with ACK */
+        uint8_t en_dpl : 1;     /**< Enables dynamic payload length */
+        uint8_t : 5;
+    } __attribute__((packed));
+    uint8_t val; /** RAW value */
+} eg_nrf24l01_feature_reg_s;
+
 /** nRF24L01 internal machine state states */
 typedef enum
 {
@@ -150,12 +421,60 @@ typedef enum
     NRF_SM_RECEIVING_CLEAR,
     NRF_SM_TRANSMIT,
     NRF_SM_TRANSMITTING,
+    NRF_SM_TRANSMIT_CLEAR,
+    NRF_SM_TRANSMIT_CLEARING,
+    NRF_SM_OBSERVE_TX_READING,
+    NRF_SM_REG_FLUSH,
     NRF_SM_POWERING_OFF,
+    NRF_SM_POWERING_UP,
+#if EG_NRF24L01_SCAN
+    NRF_SM_SCAN_CHANNEL,
+    NRF_SM_SCAN_DWELL,
+    NRF_SM_SCAN_READING,
+#endif
     NRF_SM_MAX_STATE,
 } eg_nrf24l01_sm_state_e;
 
-/** NRF24L01 internal state structure */
+#if EG_NRF24L01_STATS
+/** NRF24L01 driver statistics counters */
 typedef struct
+{
+    uint32_t sm_steps;         /**< Number of executed state handlers */
+    uint32_t spi_transactions; /**< Number of SPI transactions */
+    uint32_t spi_bytes;        /**< Number of bytes clocked on SPI bus */
+    uint32_t rx_packets;       /**< Number of received payloads */
+    uint32_t tx_packets;       /**< Number of payloads written to module TX FIFO */
+    uint32_t rx_pipe_packets[EG_NRF24L01_MAX_ADDRESS_NO]; /**< Number of received payloads per pipe */
+    uint32_t rx_fifo_full;     /**< Number of FIFO_STATUS reads with RX FIFO full - further payloads are dropped by module */
+    uint32_t rx_ring_full;     /**< Number of RX bursts stopped because of full RX ring */
+    uint32_t tx_sent;          /**< Number of sent payloads - tx_sent + tx_failed equals tx_packets once TX FIFO is empty */
+    uint32_t tx_failed;        /**< Number of dropped payloads - MAX_RT one, flushed behind it or lost by recovery */
+    uint32_t tx_retransmits;   /**< Accumulated OBSERVE_TX ARC_CNT read after TX events */
+    uint32_t tx_lost;          /**< Accumulated OBSERVE_TX PLOS_CNT increments */
+    /** Time spent in each state machine state per visit, log2 histogram of user stats ticks */
+    uint32_t state_dwell[NRF_SM_MAX_STATE][EG_NRF24L01_STATS_HIST_BUCKETS];
+    /** Time from eg_nrf24l01_irq_handler to payload delivery, log2 histogram of user stats ticks */
+    uint32_t irq_latency[EG_NRF24L01_STATS_HIST_BUCKETS];
+} eg_nrf24l01_stats_s;
+#endif
+
+#if EG_NRF24L01_TRACE_DEPTH > 0u
+/** SPI transaction trace record - packed, so a raw dump of records has the same layout on every target */
+typedef struct __attribute__((packed))
+{
+    uint32_t timestamp;                      /**< User stats ticks at transaction start */
+    uint8_t sm_state;                        /**< State machine state which issued the transaction */
+    uint8_t tx_len;                          /**< Transaction tx length */
+    uint8_t rx_len;                          /**< Transaction rx length */
+    uint8_t tx[EG_NRF24L01_TRACE_DATA_LEN]; /**< Leading tx bytes - command byte first */
+    uint8_t rx[EG_NRF24L01_TRACE_DATA_LEN]; /**< Leading rx bytes - STATUS byte first */
+} eg_nrf24l01_trace_rec_s;
+#endif
+
+struct eg_nrf24l01_bus_s;
+
+/** NRF24L01 internal state structure */
+typedef struct eg_nrf24l01_state_s
 {
     /** nRF24L01 module registers cache*/
     struct
@@ -164,6 +483,9 @@ typedef struct
         eg_nrf24l01_en_rxaddr_reg_s en_aa;                 /**< EN_AA register value */
         eg_nrf24l01_en_rxaddr_reg_s en_rxaddr;             /**< EN_RXADDR register value */
         eg_nrf24l01_setup_aw_reg_s setup_aw;               /**< SETUP_AW register value */
+        eg_nrf24l01_setup_retr_reg_s setup_retr;           /**< SETUP_RETR register value */
+        eg_nrf24l01_rf_ch_reg_s rf_ch;                     /**< RF_CH register value */
+        eg_nrf24l01_rf_setup_reg_s rf_setup;               /**< RF_SETUP register value */
         eg_nrf24l01_status_reg_s status;                   /**< STATUS register value */
         eg_nrf24l01_status_reg_s status_out;               /**< output STATUS register value */
         uint8_t rx_addr_p0[EG_NRF24L01_ADDRESS_MAX_WIDTH]; /**< RX address on PIPE 0 */
@@ -172,6 +494,7 @@ typedef struct
         uint8_t rx_addr_p3;                                /**< RX address on PIPE 3 - four MSB ar the same as on P1 */
         uint8_t rx_addr_p4;                                /**< RX address on PIPE 4 - four MSB ar the same as on P1 */
         uint8_t rx_addr_p5;                                /**< RX address on PIPE 5 - four MSB ar the same as on P1 */
+        uint8_t tx_addr[EG_NRF24L01_ADDRESS_MAX_WIDTH];    /**< TX address */
         eg_nrf24l01_rx_pw_px_reg_s rx_pw_p0;               /**< RX data size in pipe 0 */
         eg_nrf24l01_rx_pw_px_reg_s rx_pw_p1;               /**< RX data size in pipe 1 */
         eg_nrf24l01_rx_pw_px_reg_s rx_pw_p2;               /**< RX data size in pipe 2 */
@@ -179,13 +502,17 @@ typedef struct
         eg_nrf24l01_rx_pw_px_reg_s rx_pw_p4;               /**< RX data size in pipe 4 */
         eg_nrf24l01_rx_pw_px_reg_s rx_pw_p5;               /**< RX data size in pipe 5 */
         eg_nrf24l01_fifo_status_reg_s fifo_status;         /**< FIFO_STATUS register value */
+        eg_nrf24l01_dynpd_reg_s dynpd;                     /**< DYNPD register value */
+        eg_nrf24l01_feature_reg_s feature;                 /**< FEATURE register value */
     } config_registers;
 
-    /** RX pipes user configuration */
+#if EG_NRF24L01_RX_RING_SIZE == 0u
+    /** RX pipes user configuration - payload width is kept in RX_PW_Px register cache */
     struct
     {
         eg_nrf_rx_callback rx_callback; /**< User data received callback */
-    } rx_pipe[EG_NRF24L01_ADDRESS_MAX_WIDTH];
+    } rx_pipe[EG_NRF24L01_MAX_ADDRESS_NO];
+#endif
 
     /** Set Chip Enable GPIO user callback */
     eg_nrf_set_pin_state_callback set_ce_callback;
@@ -193,36 +520,149 @@ typedef struct
     eg_nrf_set_pin_state_callback set_csn_callback;
     /** Get IRQ pin state user callback */
     eg_nrf_get_pin_state_callback get_irq_callback;
+    /** Driver event user callback */
+    eg_nrf_event_callback event_callback;
+    /** SPI transfer abort user callback */
+    eg_nrf_spi_abort_callback spi_abort_callback;
 
     /* SPI specific */
     /** Local SPI tx buffer */
-    uint8_t spi_tx_buf[50];
+    uint8_t spi_tx_buf[EG_NRF24L01_SPI_TX_BUF_SIZE];
     /** Local SPI rx buffer */
-    uint8_t spi_rx_buf[50];
-    /** Local SPI rx data length value */
-    volatile uint8_t spi_rx_data_len;
+    uint8_t spi_rx_buf[EG_NRF24L01_SPI_RX_BUF_SIZE];
+    /** Time the current SPI transfer was requested in us */
+    uint32_t spi_start_us;
+    /** Shared SPI bus the instance is attached to, NULL - exclusive bus */
+    struct eg_nrf24l01_bus_s *bus;
+    /** Transfer waiting for shared bus grant */
+    struct
+    {
+        uint8_t *tx_buf;         /**< Transfer tx buffer */
+        uint8_t *rx_buf;         /**< Transfer rx buffer */
+        uint8_t tx_len;          /**< Transfer tx length */
+        uint8_t rx_len;          /**< Transfer rx length */
+        volatile uint8_t waiting; /**< Transfer waits for the bus */
+    } bus_transfer;
 
     /* Receive part */
     /** Saved RX pipe number between SM states */
     uint8_t curr_rx_pipe;
     /** Length of data to receive from module */
     uint8_t rx_data_len;
+    /** Time of the last IRQ in us */
+    volatile uint32_t irq_time_us;
+    /** Time of the IRQ which started current RX burst in us */
+    uint32_t rx_time_us;
+#if EG_NRF24L01_RX_RING_SIZE > 0u
+    /** RX payload ring - payloads are read from module directly into the slots */
+    struct
+    {
+        uint8_t buf[1u + EG_NRF24L01_MAX_PAYLOAD_LEN]; /**< STATUS byte followed by payload */
+        uint8_t len;                                  /**< Payload length */
+        uint8_t pipe;                                 /**< Pipe number the payload was received on */
+        uint32_t time_us;                             /**< Time of the IRQ which signalled the payload in us */
+    } rx_ring[EG_NRF24L01_RX_RING_SIZE];
+    /** RX ring write index - modified only by the state machine */
+    volatile uint8_t rx_ring_head;
+    /** RX ring read index - modified only by eg_nrf24l01_rx_release */
+    volatile uint8_t rx_ring_tail;
+#endif
+
+    /* Transmit part */
+    /** Software TX queue */
+    struct
+    {
+        uint8_t buf[1u + EG_NRF24L01_MAX_PAYLOAD_LEN]; /**< W_TX_PAYLOAD / W_ACK_PAYLOAD command byte followed by payload */
+        uint8_t len;                                  /**< Payload length */
+    } tx_queue[EG_NRF24L01_TX_QUEUE_SIZE];
+    /** TX queue write index - modified only by eg_nrf24l01_send */
+    volatile uint8_t tx_queue_head;
+    /** TX queue read index - modified only by the state machine */
+    volatile uint8_t tx_queue_tail;
+    /** Upper bound of payloads held in module TX FIFO */
+    uint8_t tx_fifo_level;
+    /** Payloads written to module TX FIFO and not reported as sent or failed yet */
+    uint8_t tx_unreported;
+    /** Time of the last payload write or TX event in us */
+    uint32_t tx_progress_us;
+
+    /* Event counters for upper layers - wrap around */
+    /** Number of delivered payloads */
+    volatile uint16_t rx_cnt;
+    /** Number of sent payloads - TX_DS events, payloads merged into one TX_DS are counted each */
+    volatile uint8_t tx_ds_cnt;
+    /** Number of dropped payloads - MAX_RT one, payloads flushed behind it and payloads lost by recovery */
+    volatile uint8_t tx_max_rt_cnt;
+    /** Sum of ARC_CNT read after TX events - counted with EG_NRF24L01_OBSERVE_TX or EG_NRF24L01_STATS */
+    volatile uint16_t tx_arc_cnt;
+    /** Number of recoveries after EG_NRF24L01_SPI_TIMEOUT_US */
+    volatile uint16_t spi_timeout_cnt;
+    /** Number of recoveries after EG_NRF24L01_TX_TIMEOUT_US */
+    volatile uint16_t tx_timeout_cnt;
 
     /* SM data */
-    /** Machine state internal Power On Request flag */
-    volatile uint8_t power_on_request;
-    /** Machine state internal Wake Up Request flag */
-    volatile uint8_t wake_up_request;
-    /** Machine state internal Sleep Request flag */
-    volatile uint8_t sleep_request;
-    /** Machine state SPI data ready flag */
-    volatile uint8_t spi_data_ready;
-    /** Saved timestamp value */
-    uint64_t timestamp;
+    /** Requests and events shared between contexts - FLAG_x bits, modified only with EG_NRF24L01_ATOMIC_x */
+    volatile uint8_t flags;
+    /** Flags written only by init and the state machine itself */
+    struct
+    {
+        uint8_t irq_driven : 1;         /**< IRQ events signalled by eg_nrf24l01_irq_handler instead of IRQ pin polling */
+        uint8_t spi_chaining : 1;       /**< SPI completion and IRQ advance the state machine directly */
+        uint8_t tx_writing : 1;         /**< Payload write to TX FIFO in progress */
+        uint8_t ce_state : 1;           /**< Current CE pin state */
+        uint8_t reg_flush_ce : 1;       /**< CE pin state restored after shadow registers flush */
+        uint8_t observe_tx_pending : 1; /**< OBSERVE_TX has to be read after TX event clear - STATS or OBSERVE_TX only */
+    };
+    /** Shadow registers not written to module yet - one bit per configuration script entry */
+    volatile uint32_t reg_dirty;
+#if EG_NRF24L01_SCAN
+    /** RPD spectrum scanner */
+    struct
+    {
+        uint8_t occupancy[EG_NRF24L01_CHANNEL_CNT]; /**< Number of RPD samples above -64 dBm per channel */
+        uint8_t channel;                            /**< Currently scanned channel */
+        uint8_t last_channel;                       /**< Last channel of the sweep */
+        uint8_t samples;                            /**< RPD samples per channel */
+        uint8_t sample;                             /**< Current sample number */
+        volatile uint8_t request;                   /**< Scan requested or in progress flag */
+        uint8_t aborted;                            /**< Last sweep ended by recovery flag */
+    } scan;
+#endif
+    /** Deadline of the current power transition in us */
+    uint32_t timestamp;
     /** State machine state */
     eg_nrf24l01_sm_state_e sm_state;
+#if EG_NRF24L01_STATS
+    /** Driver statistics */
+    eg_nrf24l01_stats_s stats;
+    /** Stats ticks at which current state was entered */
+    uint32_t stats_state_enter;
+    /** Stats ticks of the last IRQ */
+    volatile uint32_t stats_irq_ticks;
+    /** Last read PLOS_CNT value */
+    uint8_t stats_plos_cnt;
+#endif
+#if EG_NRF24L01_TRACE_DEPTH > 0u
+    /** SPI transaction trace ring - slot of trace_cnt holds the transaction in progress */
+    eg_nrf24l01_trace_rec_s trace[EG_NRF24L01_TRACE_DEPTH];
+    /** Number of completed traced transactions */
+    volatile uint32_t trace_cnt;
+#endif
 } eg_nrf24l01_state_s;
 
+/** Shared SPI bus arbiter */
+typedef struct eg_nrf24l01_bus_s
+{
+    /** Instances attached to the bus */
+    eg_nrf24l01_state_s *instance[EG_NRF24L01_BUS_MAX_INSTANCES];
+    /** Number of attached instances */
+    uint8_t instance_cnt;
+    /** Instance with transfer in progress, NULL - bus free, the bus itself - next instance being picked */
+    eg_nrf24l01_state_s *volatile owner;
+    /** Round robin start index */
+    uint8_t rr_next;
+} eg_nrf24l01_bus_s;
+
 /**
  * @}
  * @}
@@ -0,0 +1,403 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "eg_nrf24l01_link.h"
+
+/**
+ * @addtogroup NRF24L01_link
+ * @{
+ *
+ */
+
+#define LINK_HISTORY_MASK (EG_NRF24L01_LINK_HISTORY - 1u)
+_Static_assert(EG_NRF24L01_LINK_HISTORY >= 1u, "EG_NRF24L01_LINK_HISTORY must be at least 1");
+_Static_assert((EG_NRF24L01_LINK_HISTORY & LINK_HISTORY_MASK) == 0u, "EG_NRF24L01_LINK_HISTORY must be a power of two");
+_Static_assert(EG_NRF24L01_STATS || EG_NRF24L01_OBSERVE_TX, "Link adaptation needs EG_NRF24L01_OBSERVE_TX or EG_NRF24L01_STATS");
+_Static_assert(EG_NRF24L01_LINK_WINDOW >= 1u && EG_NRF24L01_LINK_WINDOW <= 128u, "EG_NRF24L01_LINK_WINDOW out of range");
+
+/** Age of never measured data rate */
+#define LINK_AGE_NEVER UINT8_MAX
+/** Retransmit count step after too many MAX_RT events */
+#define LINK_ARC_STEP 2u
+/** Maximum retransmit count and delay */
+#define LINK_RETR_MAX 15u
+/** Maximum retransmit delay increase above data rate minimum */
+#define LINK_ARD_SPAN 4u
+
+/** Data rate in kbps indexed by eg_nrf_data_rate_e */
+static const uint16_t link_rate_kbps[EG_NRF24L01_LINK_RATE_CNT] = {1000u, 2000u, 250u};
+/** Data rates ordered from the slowest */
+static const eg_nrf_data_rate_e link_rate_ladder[EG_NRF24L01_LINK_RATE_CNT] = {DATA_RATE_250KBPS, DATA_RATE_1MBPS, DATA_RATE_2MBPS};
+/** Position of data rate in the ladder indexed by eg_nrf_data_rate_e */
+static const uint8_t link_rate_pos[EG_NRF24L01_LINK_RATE_CNT] = {1u, 2u, 0u};
+/** Minimum ARD per data rate without / with ACK payloads - 250 kbps needs 500us for plain ACK,
+ * 32 byte ACK payload needs 500us at 1 and 2 Mbps and 1500us at 250 kbps */
+static const uint8_t link_ard_min[2u][EG_NRF24L01_LINK_RATE_CNT] = {{0u, 0u, 1u}, {1u, 1u, 5u}};
+
+static uint8_t link_ard_min_get(eg_nrf24l01_link_s *link, eg_nrf_data_rate_e rate);
+static eg_nrf_data_rate_e link_rate_step(uint8_t rate_mask, eg_nrf_data_rate_e rate, int8_t dir);
+static void link_rate_change(eg_nrf24l01_link_s *link, eg_nrf_data_rate_e rate);
+static void link_apply(eg_nrf24l01_link_s *link);
+static void link_decide(eg_nrf24l01_link_s *link, uint8_t delivered, uint8_t failed, uint16_t retransmits);
+
+eg_nrf_error_e eg_nrf24l01_link_init(eg_nrf24l01_link_s *link, eg_nrf24l01_state_s *radio,
+                                     const eg_nrf24l01_link_dest_init_s *dest, uint8_t dest_cnt)
+{
+    if (NULL == link || NULL == radio || NULL == dest || 0u == dest_cnt || dest_cnt > EG_NRF24L01_LINK_MAX_DEST)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    for (uint8_t i = 0u; i < dest_cnt; i++)
+    {
+        if (dest[i].rate > DATA_RATE_250KBPS || 0u == (dest[i].rate_mask & (1u << dest[i].rate)))
+        {
+            return NRF_INVALID_ARGUMENT;
+        }
+    }
+
+    memset(link, 0, sizeof(*link));
+    link->radio = radio;
+    link->dest_cnt = dest_cnt;
+    link->current = dest_cnt;
+
+    for (uint8_t i = 0u; i < dest_cnt; i++)
+    {
+        eg_nrf24l01_link_setting_s *setting = &link->dest[i].setting;
+
+        memcpy(link->dest[i].address, dest[i].address, sizeof(link->dest[i].address));
+        link->dest[i].rate_mask = dest[i].rate_mask;
+        link->dest[i].prev_rate = dest[i].rate;
+        setting->rate = dest[i].rate;
+        setting->ard = link_ard_min_get(link, dest[i].rate);
+        setting->arc = EG_NRF24L01_LINK_ARC_MIN;
+        for (uint8_t r = 0u; r < EG_NRF24L01_LINK_RATE_CNT; r++)
+        {
+            setting->age[r] = LINK_AGE_NEVER;
+        }
+    }
+
+    return eg_nrf24l01_link_select(link, 0u);
+}
+
+eg_nrf_error_e eg_nrf24l01_link_select(eg_nrf24l01_link_s *link, uint8_t dest)
+{
+    eg_nrf24l01_state_s *radio;
+
+    if (NULL == link || NULL == link->radio || dest >= link->dest_cnt)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    radio = link->radio;
+    if (link->current == dest)
+    {
+        return NRF_OK;
+    }
+    if (radio->tx_queue_head != radio->tx_queue_tail || 0u != radio->tx_fifo_level)
+    {
+        return NRF_BUSY;
+    }
+
+    link->current = dest;
+    eg_nrf24l01_tx_address_set(radio, link->dest[dest].address);
+    eg_nrf24l01_rx_address_set(radio, 0u, link->dest[dest].address);
+    link_apply(link);
+
+    /* New window - events of previous destination are not counted */
+    link->tx_ds_cnt = radio->tx_ds_cnt;
+    link->tx_max_rt_cnt = radio->tx_max_rt_cnt;
+    link->tx_arc_cnt = radio->tx_arc_cnt;
+
+    return NRF_OK;
+}
+
+void eg_nrf24l01_link_process(eg_nrf24l01_link_s *link)
+{
+    eg_nrf24l01_state_s *radio;
+    uint8_t delivered;
+    uint8_t failed;
+    uint16_t retransmits;
+
+    if (NULL == link || NULL == link->radio || link->current >= link->dest_cnt)
+    {
+        /* No destination selected yet - selection after init was busy */
+        return;
+    }
+
+    radio = link->radio;
+    delivered = (uint8_t)(radio->tx_ds_cnt - link->tx_ds_cnt);
+    failed = (uint8_t)(radio->tx_max_rt_cnt - link->tx_max_rt_cnt);
+    if ((uint16_t)delivered + failed < EG_NRF24L01_LINK_WINDOW)
+    {
+        return;
+    }
+
+    retransmits = (uint16_t)(radio->tx_arc_cnt - link->tx_arc_cnt);
+    link->tx_ds_cnt += delivered;
+    link->tx_max_rt_cnt += failed;
+    link->tx_arc_cnt += retransmits;
+
+    link_decide(link, delivered, failed, retransmits);
+}
+
+eg_nrf_error_e eg_nrf24l01_link_setting_get(eg_nrf24l01_link_s *link, uint8_t dest,
+                                            eg_nrf24l01_link_setting_s *setting)
+{
+    if (NULL == link || NULL == setting || dest >= link->dest_cnt)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    *setting = link->dest[dest].setting;
+
+    return NRF_OK;
+}
+
+uint16_t eg_nrf24l01_link_history_get(eg_nrf24l01_link_s *link, eg_nrf24l01_link_decision_s *decisions,
+                                      uint16_t max_cnt)
+{
+    if (NULL == link || NULL == decisions)
+    {
+        return 0u;
+    }
+
+    uint32_t cnt = link->history_cnt;
+    uint32_t avail = (cnt < EG_NRF24L01_LINK_HISTORY) ? cnt : EG_NRF24L01_LINK_HISTORY;
+    uint16_t copy_cnt = (avail < max_cnt) ? (uint16_t)avail : max_cnt;
+
+    for (uint16_t i = 0u; i < copy_cnt; i++)
+    {
+        decisions[i] = link->history[(cnt - copy_cnt + i) & LINK_HISTORY_MASK];
+    }
+
+    return copy_cnt;
+}
+
+eg_nrf_error_e eg_nrf24l01_link_follow_init(eg_nrf24l01_link_follow_s *follow, eg_nrf24l01_state_s *radio,
+                                            uint8_t rate_mask, uint32_t timeout_us)
+{
+    if (NULL == follow || NULL == radio || 0u == (rate_mask & 0x07u) || 0u == timeout_us)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    follow->radio = radio;
+    follow->rate_mask = rate_mask;
+    follow->timeout_us = timeout_us;
+    follow->last_us = eg_nrf24l01_user_time_us_get();
+    follow->rx_cnt = radio->rx_cnt;
+    if (1u == radio->config_registers.rf_setup.rf_dr_low)
+    {
+        follow->rate = DATA_RATE_250KBPS;
+    }
+    else if (1u == radio->config_registers.rf_setup.rf_dr_high)
+    {
+        follow->rate = DATA_RATE_2MBPS;
+    }
+    else
+    {
+        follow->rate = DATA_RATE_1MBPS;
+    }
+
+    return NRF_OK;
+}
+
+void eg_nrf24l01_link_follow_process(eg_nrf24l01_link_follow_s *follow)
+{
+    uint32_t now;
+
+    if (NULL == follow || NULL == follow->radio)
+    {
+        return;
+    }
+
+    now = eg_nrf24l01_user_time_us_get();
+    if (follow->rx_cnt != follow->radio->rx_cnt)
+    {
+        follow->rx_cnt = follow->radio->rx_cnt;
+        follow->last_us = now;
+    }
+    else if (now - follow->last_us > follow->timeout_us)
+    {
+        /* PTX silent or changed data rate - try the next allowed one, fastest after slowest */
+        uint8_t pos = link_rate_pos[follow->rate];
+        do
+        {
+            pos = (pos + 1u) % EG_NRF24L01_LINK_RATE_CNT;
+        } while (0u == (follow->rate_mask & (1u << link_rate_ladder[pos])));
+
+        follow->rate = link_rate_ladder[pos];
+        eg_nrf24l01_rf_set(follow->radio, follow->rate, (eg_nrf_rf_power_e)follow->radio->config_registers.rf_setup.rf_pwr);
+        follow->last_us = now;
+    }
+}
+
+static uint8_t link_ard_min_get(eg_nrf24l01_link_s *link, eg_nrf_data_rate_e rate)
+{
+    return link_ard_min[link->radio->config_registers.feature.en_ack_pay][rate];
+}
+
+static eg_nrf_data_rate_e link_rate_step(uint8_t rate_mask, eg_nrf_data_rate_e rate, int8_t dir)
+{
+    int8_t pos = (int8_t)link_rate_pos[rate] + dir;
+
+    /* Nearest allowed data rate in given direction, the same one if there is none */
+    while (pos >= 0 && pos < (int8_t)EG_NRF24L01_LINK_RATE_CNT)
+    {
+        if (0u != (rate_mask & (1u << link_rate_ladder[pos])))
+        {
+            return link_rate_ladder[pos];
+        }
+        pos += dir;
+    }
+
+    return rate;
+}
+
+static void link_rate_change(eg_nrf24l01_link_s *link, eg_nrf_data_rate_e rate)
+{
+    eg_nrf24l01_link_setting_s *setting = &link->dest[link->current].setting;
+
+    setting->rate = rate;
+    setting->ard = link_ard_min_get(link, rate);
+    link->dest[link->current].switch_windows = EG_NRF24L01_LINK_SWITCH_WINDOWS + 1u;
+}
+
+static void link_apply(eg_nrf24l01_link_s *link)
+{
+    eg_nrf24l01_link_setting_s *setting = &link->dest[link->current].setting;
+
+    /* Registers are written by the driver once module TX FIFO is empty */
+    eg_nrf24l01_rf_set(link->radio, setting->rate, (eg_nrf_rf_power_e)link->radio->config_registers.rf_setup.rf_pwr);
+    eg_nrf24l01_retransmit_set(link->radio, setting->ard, setting->arc);
+}
+
+static void link_decide(eg_nrf24l01_link_s *link, uint8_t delivered, uint8_t failed, uint16_t retransmits)
+{
+    eg_nrf24l01_link_decision_s *decision = &link->history[link->history_cnt & LINK_HISTORY_MASK];
+    eg_nrf24l01_link_setting_s *setting = &link->dest[link->current].setting;
+    uint8_t rate_mask = link->dest[link->current].rate_mask;
+    uint16_t events = (uint16_t)delivered + failed;
+    /* MAX_RT ARC_CNT holds all retransmissions, so attempts are events plus ARC_CNT sum */
+    uint32_t goodput = (uint32_t)link_rate_kbps[setting->rate] * delivered / (events + retransmits);
+    eg_nrf_link_reason_e reason = LINK_KEEP;
+
+    if (0u != link->dest[link->current].switch_windows &&
+        (link->dest[link->current].switch_windows > EG_NRF24L01_LINK_SWITCH_WINDOWS || failed > EG_NRF24L01_LINK_LOSS_MAX))
+    {
+        /* Window with the data rate change or PRX has not followed it yet - it says nothing about the rate */
+        link->dest[link->current].switch_windows--;
+    }
+    else
+    {
+        link->dest[link->current].switch_windows = 0u;
+
+        for (uint8_t r = 0u; r < EG_NRF24L01_LINK_RATE_CNT; r++)
+        {
+            if (setting->age[r] < LINK_AGE_NEVER - 1u)
+            {
+                setting->age[r]++;
+            }
+        }
+        /* Outdated goodput is replaced, recent one averaged */
+        setting->goodput[setting->rate] = (setting->age[setting->rate] > EG_NRF24L01_LINK_PROBE_WINDOWS)
+                                              ? (uint16_t)goodput
+                                              : (uint16_t)((3u * setting->goodput[setting->rate] + goodput) / 4u);
+        setting->age[setting->rate] = 0u;
+
+        if (1u == link->dest[link->current].probing)
+        {
+            link->dest[link->current].probing = 0u;
+            if (setting->goodput[setting->rate] < setting->goodput[link->dest[link->current].prev_rate])
+            {
+                link_rate_change(link, link->dest[link->current].prev_rate);
+                reason = LINK_REVERT;
+            }
+        }
+        else if (failed > EG_NRF24L01_LINK_LOSS_MAX)
+        {
+            /* More retransmissions first, then spread them over longer time against interference
+             * bursts, slower data rate as the last step */
+            if (setting->arc < LINK_RETR_MAX)
+            {
+                setting->arc = (setting->arc + LINK_ARC_STEP > LINK_RETR_MAX) ? LINK_RETR_MAX : setting->arc + LINK_ARC_STEP;
+                reason = LINK_ARC_UP;
+            }
+            else if (setting->ard < link_ard_min_get(link, setting->rate) + LINK_ARD_SPAN)
+            {
+                setting->ard++;
+                reason = LINK_ARD_UP;
+            }
+            else if (link_rate_step(rate_mask, setting->rate, -1) != setting->rate)
+            {
+                link_rate_change(link, link_rate_step(rate_mask, setting->rate, -1));
+                reason = LINK_RATE_DOWN;
+            }
+        }
+
+        if (LINK_KEEP == reason)
+        {
+            eg_nrf_data_rate_e best = setting->rate;
+            eg_nrf_data_rate_e faster = link_rate_step(rate_mask, setting->rate, 1);
+            eg_nrf_data_rate_e slower = link_rate_step(rate_mask, setting->rate, -1);
+
+            for (uint8_t r = 0u; r < EG_NRF24L01_LINK_RATE_CNT; r++)
+            {
+                if (0u != (rate_mask & (1u << r)) && setting->age[r] <= EG_NRF24L01_LINK_PROBE_WINDOWS &&
+                    setting->goodput[r] > setting->goodput[best])
+                {
+                    best = (eg_nrf_data_rate_e)r;
+                }
+            }
+
+            if (best != setting->rate)
+            {
+                link_rate_change(link, best);
+                reason = LINK_RATE_BEST;
+            }
+            else if ((faster != setting->rate && setting->age[faster] > EG_NRF24L01_LINK_PROBE_WINDOWS) ||
+                     (slower != setting->rate && setting->age[slower] > EG_NRF24L01_LINK_PROBE_WINDOWS))
+            {
+                /* Faster data rate probed first */
+                link->dest[link->current].prev_rate = setting->rate;
+                link->dest[link->current].probing = 1u;
+                link_rate_change(link, (faster != setting->rate && setting->age[faster] > EG_NRF24L01_LINK_PROBE_WINDOWS) ? faster : slower);
+                reason = LINK_PROBE;
+            }
+            else if (0u == failed && 4u * retransmits < events && setting->ard > link_ard_min_get(link, setting->rate))
+            {
+                setting->ard--;
+                reason = LINK_ARD_DOWN;
+            }
+            else if (0u == failed && 4u * retransmits < events && setting->arc > EG_NRF24L01_LINK_ARC_MIN)
+            {
+                setting->arc--;
+                reason = LINK_ARC_DOWN;
+            }
+        }
+
+        if (LINK_KEEP != reason)
+        {
+            link_apply(link);
+        }
+    }
+
+    decision->time_us = eg_nrf24l01_user_time_us_get();
+    decision->dest = link->current;
+    decision->delivered = delivered;
+    decision->failed = failed;
+    decision->retransmits = retransmits;
+    decision->goodput = (uint16_t)goodput;
+    decision->rate = setting->rate;
+    decision->ard = setting->ard;
+    decision->arc = setting->arc;
+    decision->reason = reason;
+    link->history_cnt++;
+}
+
+/**
+ * @}
+ *
+ */
@@ -0,0 +1,216 @@
+#ifndef _EG_NRF24L01_LINK_H_
+#define _EG_NRF24L01_LINK_H_
+#include "stdint.h"
+#include "eg_nrf24l01.h"
+
+/**
+ * @addtogroup NRF24L01_link NRF24L01 link adaptation layer
+ * @{
+ * @brief Closed loop retransmission and data rate controller of PTX side. Every
+ * EG_NRF24L01_LINK_WINDOW TX events it evaluates TX_DS / MAX_RT counts and ARC_CNT sum
+ * read from OBSERVE_TX and adjusts ARD, ARC and data rate of the current destination.
+ * PRX side follows data rate changes with eg_nrf24l01_link_follow_process.
+ * Driver has to be built with EG_NRF24L01_OBSERVE_TX or EG_NRF24L01_STATS enabled.
+ */
+
+#ifndef EG_NRF24L01_LINK_MAX_DEST
+/** Maximum number of destinations */
+#define EG_NRF24L01_LINK_MAX_DEST 4u
+#endif
+
+#ifndef EG_NRF24L01_LINK_WINDOW
+/** Number of TX events (TX_DS + MAX_RT) evaluated by one controller decision */
+#define EG_NRF24L01_LINK_WINDOW 16u
+#endif
+
+#ifndef EG_NRF24L01_LINK_LOSS_MAX
+/** Accepted number of MAX_RT events per window */
+#define EG_NRF24L01_LINK_LOSS_MAX 1u
+#endif
+
+#ifndef EG_NRF24L01_LINK_ARC_MIN
+/** Lowest retransmit count the controller goes down to */
+#define EG_NRF24L01_LINK_ARC_MIN 3u
+#endif
+
+#ifndef EG_NRF24L01_LINK_PROBE_WINDOWS
+/** Number of windows after which goodput of another allowed data rate is measured again */
+#define EG_NRF24L01_LINK_PROBE_WINDOWS 32u
+#endif
+
+#ifndef EG_NRF24L01_LINK_SWITCH_WINDOWS
+/** Number of failing windows not evaluated after data rate change - time for PRX to follow,
+ * the window with the change itself is never evaluated */
+#define EG_NRF24L01_LINK_SWITCH_WINDOWS 2u
+#endif
+
+#ifndef EG_NRF24L01_LINK_HISTORY
+/** Decision history depth in records - must be a power of two */
+#define EG_NRF24L01_LINK_HISTORY 16u
+#endif
+
+/** Number of data rates */
+#define EG_NRF24L01_LINK_RATE_CNT 3u
+
+/** Controller decision */
+typedef enum
+{
+    LINK_KEEP = 0,      /**< Settings kept */
+    LINK_ARC_UP = 1,    /**< Retransmit count increased - too many MAX_RT */
+    LINK_ARC_DOWN = 2,  /**< Retransmit count decreased - no MAX_RT, few retransmissions */
+    LINK_ARD_UP = 3,    /**< Retransmit delay increased - loss with maximum retransmit count */
+    LINK_ARD_DOWN = 4,  /**< Retransmit delay decreased - few retransmissions */
+    LINK_RATE_DOWN = 5, /**< Slower data rate - loss with maximum retransmit count and delay */
+    LINK_RATE_BEST = 6, /**< Data rate with better measured goodput selected */
+    LINK_PROBE = 7,     /**< Data rate with outdated goodput measured */
+    LINK_REVERT = 8,    /**< Probed data rate worse - previous one restored */
+} eg_nrf_link_reason_e;
+
+/** Destination initialisation data */
+typedef struct
+{
+    uint8_t address[EG_NRF24L01_ADDRESS_MAX_WIDTH]; /**< Destination address, LSByte first */
+    uint8_t rate_mask;                              /**< Allowed data rates - bit (1 << eg_nrf_data_rate_e) each */
+    eg_nrf_data_rate_e rate;                        /**< Initial data rate - has to be allowed */
+} eg_nrf24l01_link_dest_init_s;
+
+/** Destination link settings */
+typedef struct
+{
+    eg_nrf_data_rate_e rate;                           /**< Data rate */
+    uint8_t ard;                                       /**< Retransmit delay, (ard + 1) * 250us */
+    uint8_t arc;                                       /**< Retransmit count */
+    uint16_t goodput[EG_NRF24L01_LINK_RATE_CNT];       /**< Averaged goodput per data rate in kbps - data rate scaled by delivered payloads per attempt */
+    uint8_t age[EG_NRF24L01_LINK_RATE_CNT];            /**< Windows since goodput of the data rate was measured, 255 - never */
+} eg_nrf24l01_link_setting_s;
+
+/** Controller decision record */
+typedef struct
+{
+    uint32_t time_us;                 /**< Decision time */
+    uint8_t dest;                     /**< Destination index */
+    uint8_t delivered;                /**< TX_DS events in the window */
+    uint8_t failed;                   /**< MAX_RT events in the window */
+    uint16_t retransmits;             /**< ARC_CNT sum of the window */
+    uint16_t goodput;                 /**< Goodput of the window in kbps */
+    eg_nrf_data_rate_e rate;          /**< Data rate after the decision */
+    uint8_t ard;                      /**< Retransmit delay after the decision */
+    uint8_t arc;                      /**< Retransmit count after the decision */
+    eg_nrf_link_reason_e reason;      /**< Decision */
+} eg_nrf24l01_link_decision_s;
+
+/** Link adaptation layer state */
+typedef struct
+{
+    eg_nrf24l01_state_s *radio; /**< Driver instance */
+    struct
+    {
+        uint8_t address[EG_NRF24L01_ADDRESS_MAX_WIDTH]; /**< Destination address */
+        uint8_t rate_mask;                              /**< Allowed data rates */
+        eg_nrf24l01_link_setting_s setting;             /**< Current settings */
+        eg_nrf_data_rate_e prev_rate;                   /**< Data rate before the probe */
+        uint8_t probing;                                /**< Current data rate is being probed */
+        uint8_t switch_windows;                         /**< Windows waited for PRX after data rate change */
+    } dest[EG_NRF24L01_LINK_MAX_DEST];
+    uint8_t dest_cnt;                                      /**< Number of destinations */
+    uint8_t current;                                       /**< Selected destination */
+    uint8_t tx_ds_cnt;                                     /**< Driver tx_ds_cnt at window start */
+    uint8_t tx_max_rt_cnt;                                 /**< Driver tx_max_rt_cnt at window start */
+    uint16_t tx_arc_cnt;                                   /**< Driver tx_arc_cnt at window start */
+    eg_nrf24l01_link_decision_s history[EG_NRF24L01_LINK_HISTORY]; /**< Decision history ring */
+    uint32_t history_cnt;                                  /**< Number of decisions */
+} eg_nrf24l01_link_s;
+
+/** PRX data rate follower state */
+typedef struct
+{
+    eg_nrf24l01_state_s *radio; /**< Driver instance */
+    uint8_t rate_mask;          /**< Data rates searched */
+    uint32_t timeout_us;        /**< Time without payload after which next data rate is tried */
+    uint32_t last_us;           /**< Time of the last payload or data rate change */
+    uint16_t rx_cnt;            /**< Driver rx_cnt seen last time */
+    eg_nrf_data_rate_e rate;    /**< Current data rate */
+} eg_nrf24l01_link_follow_s;
+
+/**
+ * Function to initialise link adaptation layer
+ * @brief Driver instance has to be initialised, destination 0 is selected.
+ * With payloads still queued in the driver destination 0 is not selected yet - link is
+ * initialised, adaptation waits until eg_nrf24l01_link_select succeeds.
+ *
+ * @param link pointer to link adaptation layer state
+ * @param radio pointer to initialised driver state object
+ * @param dest pointer to destinations table
+ * @param dest_cnt number of destinations (1 - EG_NRF24L01_LINK_MAX_DEST)
+ * @return eg_nrf_error_e error code, NRF_BUSY - destination 0 selection pending
+ */
+extern eg_nrf_error_e eg_nrf24l01_link_init(eg_nrf24l01_link_s *link, eg_nrf24l01_state_s *radio,
+                                            const eg_nrf24l01_link_dest_init_s *dest, uint8_t dest_cnt);
+
+/**
+ * Function to select destination of next payloads
+ * @brief TX address, RX pipe 0 address and destination settings are written.
+ *
+ * @param link pointer to link adaptation layer state
+ * @param dest destination index
+ * @return eg_nrf_error_e error code, NRF_BUSY - payloads for previous destination not sent yet
+ */
+extern eg_nrf_error_e eg_nrf24l01_link_select(eg_nrf24l01_link_s *link, uint8_t dest);
+
+/**
+ * Function to process link adaptation layer
+ * @brief Should be called next to eg_nrf24l01_process.
+ *
+ * @param link pointer to link adaptation layer state
+ */
+extern void eg_nrf24l01_link_process(eg_nrf24l01_link_s *link);
+
+/**
+ * Function to get current settings of a destination
+ *
+ * @param link pointer to link adaptation layer state
+ * @param dest destination index
+ * @param setting pointer to settings output
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_link_setting_get(eg_nrf24l01_link_s *link, uint8_t dest,
+                                                   eg_nrf24l01_link_setting_s *setting);
+
+/**
+ * Function to copy controller decision history
+ * @brief Records are copied oldest first.
+ *
+ * @param link pointer to link adaptation layer state
+ * @param decisions pointer to output records table
+ * @param max_cnt size of records table
+ * @return uint16_t number of copied records
+ */
+extern uint16_t eg_nrf24l01_link_history_get(eg_nrf24l01_link_s *link, eg_nrf24l01_link_decision_s *decisions,
+                                             uint16_t max_cnt);
+
+/**
+ * Function to initialise PRX data rate follower
+ *
+ * @param follow pointer to follower state
+ * @param radio pointer to initialised driver state object
+ * @param rate_mask data rates used by PTX - bit (1 << eg_nrf_data_rate_e) each
+ * @param timeout_us time without payload after which next data rate is tried - longer than PTX payload interval
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_link_follow_init(eg_nrf24l01_link_follow_s *follow, eg_nrf24l01_state_s *radio,
+                                                   uint8_t rate_mask, uint32_t timeout_us);
+
+/**
+ * Function to process PRX data rate follower
+ * @brief Should be called next to eg_nrf24l01_process.
+ *
+ * @param follow pointer to follower state
+ */
+extern void eg_nrf24l01_link_follow_process(eg_nrf24l01_link_follow_s *follow);
+
+/**
+ * @}
+ *
+ */
+
+#endif /* _EG_NRF24L01_LINK_H_ */
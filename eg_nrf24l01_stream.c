@@ -0,0 +1,307 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "eg_nrf24l01_stream.h"
+
+/**
+ * @addtogroup NRF24L01_stream
+ * @{
+ *
+ */
+
+_Static_assert(EG_NRF24L01_STREAM_MAX_GROUP >= 2u && EG_NRF24L01_STREAM_MAX_GROUP <= 16u,
+               "EG_NRF24L01_STREAM_MAX_GROUP must be 2 - 16");
+
+/** Parity frame flag - sequence number bits hold the first frame of the group */
+#define STREAM_FLAG_PARITY 0x80u
+/** Sequence number bits of the header */
+#define STREAM_SEQ_MASK 0x7Fu
+
+static uint8_t stream_group_valid(uint8_t fec_group);
+static eg_nrf_error_e stream_tx_parity_send(eg_nrf24l01_stream_tx_s *tx);
+static void stream_rx_group_end(eg_nrf24l01_stream_rx_s *rx);
+static void stream_rx_recover(eg_nrf24l01_stream_rx_s *rx, const uint8_t *parity);
+
+eg_nrf_error_e eg_nrf24l01_stream_tx_init(eg_nrf24l01_stream_tx_s *tx, eg_nrf24l01_state_s *radio,
+                                          uint8_t frame_len, uint8_t fec_group)
+{
+    if (NULL == tx || NULL == radio || frame_len <= EG_NRF24L01_STREAM_HEADER_LEN ||
+        frame_len > EG_NRF24L01_MAX_PAYLOAD_LEN || 0u == stream_group_valid(fec_group))
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+    if (0u == radio->config_registers.feature.en_dyn_ack)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    memset(tx, 0, sizeof(*tx));
+    tx->radio = radio;
+    tx->frame_len = frame_len;
+    tx->fec_group = fec_group;
+
+    return NRF_OK;
+}
+
+eg_nrf_error_e eg_nrf24l01_stream_send(eg_nrf24l01_stream_tx_s *tx, const uint8_t *data)
+{
+    uint8_t payload[EG_NRF24L01_MAX_PAYLOAD_LEN];
+    uint8_t data_len;
+    eg_nrf_error_e err;
+
+    if (NULL == tx || NULL == tx->radio || NULL == data)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+    data_len = tx->frame_len - EG_NRF24L01_STREAM_HEADER_LEN;
+
+    if (1u == tx->parity_pending)
+    {
+        err = stream_tx_parity_send(tx);
+        if (NRF_OK != err)
+        {
+            return err;
+        }
+        tx->parity_pending = 0u;
+    }
+
+    payload[0u] = tx->seq;
+    memcpy(&payload[EG_NRF24L01_STREAM_HEADER_LEN], data, data_len);
+    err = eg_nrf24l01_send_no_ack(tx->radio, payload, tx->frame_len);
+    if (NRF_OK != err)
+    {
+        return err;
+    }
+    tx->seq = (tx->seq + 1u) & STREAM_SEQ_MASK;
+    tx->frames++;
+
+    if (0u != tx->fec_group)
+    {
+        for (uint8_t i = 0u; i < data_len; i++)
+        {
+            tx->parity[i] ^= data[i];
+        }
+        if (0u == (tx->seq & (tx->fec_group - 1u)))
+        {
+            /* Group complete - parity frame follows its data frames directly when queue has space */
+            if (NRF_OK != stream_tx_parity_send(tx))
+            {
+                tx->parity_pending = 1u;
+            }
+        }
+    }
+
+    return NRF_OK;
+}
+
+eg_nrf_error_e eg_nrf24l01_stream_tx_flush(eg_nrf24l01_stream_tx_s *tx)
+{
+    eg_nrf_error_e err;
+
+    if (NULL == tx || NULL == tx->radio)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+    if (0u == tx->parity_pending)
+    {
+        return NRF_OK;
+    }
+
+    err = stream_tx_parity_send(tx);
+    if (NRF_OK == err)
+    {
+        tx->parity_pending = 0u;
+    }
+
+    return err;
+}
+
+eg_nrf_error_e eg_nrf24l01_stream_rx_init(eg_nrf24l01_stream_rx_s *rx, uint8_t frame_len, uint8_t fec_group,
+                                          eg_nrf_stream_callback callback)
+{
+    if (NULL == rx || NULL == callback || frame_len <= EG_NRF24L01_STREAM_HEADER_LEN ||
+        frame_len > EG_NRF24L01_MAX_PAYLOAD_LEN || 0u == stream_group_valid(fec_group))
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+
+    memset(rx, 0, sizeof(*rx));
+    rx->callback = callback;
+    rx->frame_len = frame_len;
+    rx->fec_group = fec_group;
+
+    return NRF_OK;
+}
+
+eg_nrf_error_e eg_nrf24l01_stream_rx_input(eg_nrf24l01_stream_rx_s *rx, const uint8_t *data, uint8_t len)
+{
+    uint8_t data_len;
+    uint8_t seq;
+    uint8_t group;
+
+    if (NULL == rx || NULL == data || len != rx->frame_len)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+    if (0u != (data[0u] & STREAM_FLAG_PARITY) && 0u == rx->fec_group)
+    {
+        return NRF_INVALID_ARGUMENT;
+    }
+    data_len = len - EG_NRF24L01_STREAM_HEADER_LEN;
+    seq = data[0u] & STREAM_SEQ_MASK;
+
+    if (0u == rx->fec_group)
+    {
+        /* Frames delivered immediately - gap in sequence numbers is reported as lost frames */
+        while (1u == rx->started && rx->next != seq)
+        {
+            rx->lost++;
+            rx->callback(rx->next, NULL, 0u);
+            rx->next = (rx->next + 1u) & STREAM_SEQ_MASK;
+        }
+        rx->started = 1u;
+        rx->received++;
+        rx->next = (seq + 1u) & STREAM_SEQ_MASK;
+        rx->callback(seq, &data[EG_NRF24L01_STREAM_HEADER_LEN], data_len);
+        return NRF_OK;
+    }
+
+    group = seq & (uint8_t)~(rx->fec_group - 1u);
+    if (0u == rx->started)
+    {
+        /* Stream joined in the middle of a group - earlier frames were never expected */
+        rx->started = 1u;
+        rx->next = group;
+        rx->received_mask = 0u;
+        rx->skip_mask = (uint16_t)((1u << (seq - group)) - 1u);
+        if (0u != (data[0u] & STREAM_FLAG_PARITY))
+        {
+            rx->skip_mask = (uint16_t)((1uL << rx->fec_group) - 1u);
+        }
+    }
+
+    /* Parity frame or all frames of the group lost - groups until the current one are complete */
+    while (rx->next != group)
+    {
+        stream_rx_group_end(rx);
+    }
+
+    if (0u != (data[0u] & STREAM_FLAG_PARITY))
+    {
+        stream_rx_recover(rx, &data[EG_NRF24L01_STREAM_HEADER_LEN]);
+        stream_rx_group_end(rx);
+        return NRF_OK;
+    }
+
+    if (0u == (rx->received_mask & (1u << (seq - group))))
+    {
+        memcpy(rx->buf[seq - group], &data[EG_NRF24L01_STREAM_HEADER_LEN], data_len);
+        rx->received_mask |= (uint16_t)(1u << (seq - group));
+        rx->received++;
+    }
+
+    return NRF_OK;
+}
+
+void eg_nrf24l01_stream_rx_flush(eg_nrf24l01_stream_rx_s *rx)
+{
+    if (NULL == rx || 0u == rx->fec_group || 0u == rx->started)
+    {
+        return;
+    }
+
+    stream_rx_group_end(rx);
+    /* Next group is joined by its first received frame */
+    rx->started = 0u;
+}
+
+static uint8_t stream_group_valid(uint8_t fec_group)
+{
+    /* Groups have to be aligned to sequence number wrap - power of two */
+    return (0u == fec_group) ||
+           (fec_group >= 2u && fec_group <= EG_NRF24L01_STREAM_MAX_GROUP && 0u == (fec_group & (fec_group - 1u)));
+}
+
+static eg_nrf_error_e stream_tx_parity_send(eg_nrf24l01_stream_tx_s *tx)
+{
+    uint8_t payload[EG_NRF24L01_MAX_PAYLOAD_LEN];
+    eg_nrf_error_e err;
+
+    /* Header holds the first frame of the group - the one fec_group frames before the next frame */
+    payload[0u] = STREAM_FLAG_PARITY | ((tx->seq - tx->fec_group) & STREAM_SEQ_MASK);
+    memcpy(&payload[EG_NRF24L01_STREAM_HEADER_LEN], tx->parity, tx->frame_len - EG_NRF24L01_STREAM_HEADER_LEN);
+    err = eg_nrf24l01_send_no_ack(tx->radio, payload, tx->frame_len);
+    if (NRF_OK == err)
+    {
+        tx->parity_frames++;
+        memset(tx->parity, 0, sizeof(tx->parity));
+    }
+
+    return err;
+}
+
+static void stream_rx_group_end(eg_nrf24l01_stream_rx_s *rx)
+{
+    uint8_t data_len = rx->frame_len - EG_NRF24L01_STREAM_HEADER_LEN;
+
+    for (uint8_t i = 0u; i < rx->fec_group; i++)
+    {
+        uint8_t seq = (rx->next + i) & STREAM_SEQ_MASK;
+
+        if (0u != (rx->skip_mask & (1u << i)))
+        {
+            continue;
+        }
+        if (0u != (rx->received_mask & (1u << i)))
+        {
+            rx->callback(seq, rx->buf[i], data_len);
+        }
+        else
+        {
+            rx->lost++;
+            rx->callback(seq, NULL, 0u);
+        }
+    }
+
+    rx->next = (rx->next + rx->fec_group) & STREAM_SEQ_MASK;
+    rx->received_mask = 0u;
+    rx->skip_mask = 0u;
+}
+
+static void stream_rx_recover(eg_nrf24l01_stream_rx_s *rx, const uint8_t *parity)
+{
+    uint8_t data_len = rx->frame_len - EG_NRF24L01_STREAM_HEADER_LEN;
+    uint16_t missing = (uint16_t)(((1uL << rx->fec_group) - 1u) & ~(rx->received_mask | rx->skip_mask));
+    uint8_t idx = 0u;
+
+    if (0u == missing || 0u != (missing & (missing - 1u)) || 0u != rx->skip_mask)
+    {
+        /* Parity rebuilds exactly one frame of a complete group */
+        return;
+    }
+
+    while (0u == (missing & (1u << idx)))
+    {
+        idx++;
+    }
+
+    memcpy(rx->buf[idx], parity, data_len);
+    for (uint8_t i = 0u; i < rx->fec_group; i++)
+    {
+        if (i != idx)
+        {
+            for (uint8_t j = 0u; j < data_len; j++)
+            {
+                rx->buf[idx][j] ^= rx->buf[i][j];
+            }
+        }
+    }
+    rx->received_mask |= missing;
+    rx->recovered++;
+}
+
+/**
+ * @}
+ *
+ */
@@ -0,0 +1,133 @@
+#ifndef _EG_NRF24L01_STREAM_H_
+#define _EG_NRF24L01_STREAM_H_
+#include "stdint.h"
+#include "eg_nrf24l01.h"
+
+/**
+ * @addtogroup NRF24L01_stream NRF24L01 no-ACK streaming layer
+ * @{
+ * @brief Fixed length frames sent with W_TX_PAYLOAD_NO_ACK back to back from the driver TX
+ * queue - module stays in TX mode with CE high while frames are queued and no air time is
+ * spent on acknowledges. Every frame carries 7 bit sequence number, receiver counts lost
+ * frames from its gaps. Optional XOR parity frame after every group of frames lets receiver
+ * rebuild one lost frame per group, frames are then delivered one group later.
+ * Transmitter driver has to be initialised with no_ack enabled.
+ */
+
+#ifndef EG_NRF24L01_STREAM_MAX_GROUP
+/** Maximum number of frames protected by one parity frame - receiver buffers one group */
+#define EG_NRF24L01_STREAM_MAX_GROUP 8u
+#endif
+
+/** Frame header length - parity flag and sequence number */
+#define EG_NRF24L01_STREAM_HEADER_LEN 1u
+/** Maximum data bytes in one frame */
+#define EG_NRF24L01_STREAM_MAX_DATA_LEN (EG_NRF24L01_MAX_PAYLOAD_LEN - EG_NRF24L01_STREAM_HEADER_LEN)
+
+/**
+ * Stream frame callback
+ *
+ * @param seq frame sequence number (0 - 127)
+ * @param data pointer to frame data, NULL - frame lost
+ * @param data_size frame data length, 0 - frame lost
+ */
+typedef void (*eg_nrf_stream_callback)(uint8_t seq, const uint8_t *data, uint8_t data_size);
+
+/** Stream transmitter state */
+typedef struct
+{
+    eg_nrf24l01_state_s *radio;                         /**< Driver instance */
+    uint8_t frame_len;                                  /**< Payload length - header and data */
+    uint8_t fec_group;                                  /**< Frames per parity frame, 0 - no parity */
+    uint8_t seq;                                        /**< Sequence number of the next frame */
+    uint8_t parity_pending;                             /**< Parity frame of the last group not queued yet */
+    uint8_t parity[EG_NRF24L01_STREAM_MAX_DATA_LEN];    /**< XOR of the current group data */
+    uint32_t frames;                                    /**< Number of queued data frames */
+    uint32_t parity_frames;                             /**< Number of queued parity frames */
+} eg_nrf24l01_stream_tx_s;
+
+/** Stream receiver state */
+typedef struct
+{
+    eg_nrf_stream_callback callback;                                            /**< Frame callback */
+    uint8_t frame_len;                                                          /**< Payload length - header and data */
+    uint8_t fec_group;                                                          /**< Frames per parity frame, 0 - no parity */
+    uint8_t started;                                                            /**< First frame received */
+    uint8_t next;                                                               /**< Expected sequence number - first frame of the group with parity */
+    uint16_t received_mask;                                                     /**< Bit n - frame next + n of the group received */
+    uint16_t skip_mask;                                                         /**< Bit n - frame next + n sent before the stream was joined */
+    uint8_t buf[EG_NRF24L01_STREAM_MAX_GROUP][EG_NRF24L01_STREAM_MAX_DATA_LEN]; /**< Frames of the current group */
+    uint32_t received;                                                          /**< Number of received data frames */
+    uint32_t lost;                                                              /**< Number of lost frames - not rebuilt from parity */
+    uint32_t recovered;                                                         /**< Number of frames rebuilt from parity */
+} eg_nrf24l01_stream_rx_s;
+
+/**
+ * Function to initialise stream transmitter
+ *
+ * @param tx pointer to transmitter state
+ * @param radio pointer to driver state object initialised with no_ack enabled
+ * @param frame_len payload length (2 - 32 bytes) - data length is frame_len - EG_NRF24L01_STREAM_HEADER_LEN
+ * @param fec_group frames per parity frame - 0 or power of two 2 - EG_NRF24L01_STREAM_MAX_GROUP
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_stream_tx_init(eg_nrf24l01_stream_tx_s *tx, eg_nrf24l01_state_s *radio,
+                                                 uint8_t frame_len, uint8_t fec_group);
+
+/**
+ * Function to queue stream frame
+ * @brief Parity frame of the previous group is queued first if it did not fit before.
+ *
+ * @param tx pointer to transmitter state
+ * @param data pointer to frame data - frame_len - EG_NRF24L01_STREAM_HEADER_LEN bytes
+ * @return eg_nrf_error_e error code, NRF_TX_QUEUE_FULL - frame not queued, call again
+ */
+extern eg_nrf_error_e eg_nrf24l01_stream_send(eg_nrf24l01_stream_tx_s *tx, const uint8_t *data);
+
+/**
+ * Function to queue parity frame of the last group
+ * @brief Should be called when the stream stops - parity frame which did not fit TX queue
+ * is otherwise queued only by the next eg_nrf24l01_stream_send.
+ *
+ * @param tx pointer to transmitter state
+ * @return eg_nrf_error_e error code, NRF_TX_QUEUE_FULL - parity frame not queued, call again
+ */
+extern eg_nrf_error_e eg_nrf24l01_stream_tx_flush(eg_nrf24l01_stream_tx_s *tx);
+
+/**
+ * Function to initialise stream receiver
+ *
+ * @param rx pointer to receiver state
+ * @param frame_len payload length - same as transmitter one
+ * @param fec_group frames per parity frame - same as transmitter one
+ * @param callback frame callback - called for every frame in sequence order, lost frames included
+ * @return eg_nrf_error_e error code
+ */
+extern eg_nrf_error_e eg_nrf24l01_stream_rx_init(eg_nrf24l01_stream_rx_s *rx, uint8_t frame_len, uint8_t fec_group,
+                                                 eg_nrf_stream_callback callback);
+
+/**
+ * Function to pass received payload to stream receiver
+ * @brief Should be called from the driver pipe RX callback.
+ *
+ * @param rx pointer to receiver state
+ * @param data pointer to payload
+ * @param len payload length
+ * @return eg_nrf_error_e error code, NRF_INVALID_ARGUMENT - not a stream frame
+ */
+extern eg_nrf_error_e eg_nrf24l01_stream_rx_input(eg_nrf24l01_stream_rx_s *rx, const uint8_t *data, uint8_t len);
+
+/**
+ * Function to deliver frames of unfinished group
+ * @brief Should be called when the stream stops - missing frames of the group are reported lost.
+ *
+ * @param rx pointer to receiver state
+ */
+extern void eg_nrf24l01_stream_rx_flush(eg_nrf24l01_stream_rx_s *rx);
+
+/**
+ * @}
+ *
+ */
+
+#endif /* _EG_NRF24L01_STREAM_H_ */